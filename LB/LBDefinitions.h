@@ -11,6 +11,11 @@
 		  2/36.0, 1/36.0, 2/36.0, 12/36.0, 2/36.0, 1/36.0, 2/36.0, 1/36.0, 1/36.0, 1/36.0, 2/36.0,
 		  1/36.0, 1/36.0};
 
+  /* Cell types of the flag field */
+#define FLUID 0
+#define NO_SLIP 1
+#define MOVING_WALL 2
+
   /* The following threw an error at compilation time so it was defined in the functions where C_S is used:*/
   static const double C_S = 0.57735026918963;
 
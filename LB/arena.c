@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "arena.h"
+#include "helper.h"
+
+/* size of a transparent/explicit huge page on x86-64 */
+#define HUGEPAGE_SIZE (2UL*1024*1024)
+
+/* memory policy of the mbind system call (see numaif.h, which is not always installed) */
+#define ARENA_MPOL_INTERLEAVE 3
+#define ARENA_MAX_NODES 1024
+
+static const char *hugePageNames[] = {"none", "transparent", "explicit"};
+static const char *numaNames[] = {"first touch", "interleave"};
+
+/* reads the online NUMA nodes from sysfs into nodemask. Returns the number of nodes. */
+static int readOnlineNodes(unsigned long *nodemask){
+	FILE *fp = fopen("/sys/devices/system/node/online", "r");
+	int first, last, node;
+	int count = 0;
+	char sep;
+
+	if(fp == NULL){
+		return 0;
+	}
+	/* The list has the format "0-3,5,7-8" */
+	while(fscanf(fp, "%d", &first) == 1){
+		last = first;
+		sep = (char)fgetc(fp);
+		if(sep == '-'){
+			if(fscanf(fp, "%d", &last) != 1){
+				break;
+			}
+			sep = (char)fgetc(fp);
+		}
+		for(node = first; node <= last && node < ARENA_MAX_NODES; node++){
+			nodemask[node/(8*sizeof(unsigned long))] |= 1UL << (node%(8*sizeof(unsigned long)));
+			count++;
+		}
+		if(sep != ','){
+			break;
+		}
+	}
+	fclose(fp);
+	return count;
+}
+
+/* Maps the arena. Explicit huge pages fall back to transparent ones, transparent huge pages need
+ * a mapping aligned to the huge page size, which is obtained by over-allocating and skipping the
+ * unaligned head. */
+void arenaCreate(arena *a, size_t size, int hugePages, int numaPolicy){
+	unsigned long nodemask[ARENA_MAX_NODES/(8*sizeof(unsigned long))];
+	size_t offset;
+
+	memset(a, 0, sizeof(arena));
+	a->hugePages = HUGEPAGES_NONE;
+	a->numaPolicy = NUMA_FIRSTTOUCH;
+
+	if(hugePages == HUGEPAGES_EXPLICIT){
+#ifdef MAP_HUGETLB
+		a->mappingSize = (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+		a->mapping = mmap(NULL, a->mappingSize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(a->mapping != MAP_FAILED){
+			a->hugePages = HUGEPAGES_EXPLICIT;
+		}
+		else{
+			a->mapping = NULL;
+		}
+#endif
+		if(a->mapping == NULL){
+			printf("Arena: no explicit huge pages available, trying transparent huge pages\n");
+			hugePages = HUGEPAGES_TRANSPARENT;
+		}
+	}
+
+	if(a->mapping == NULL){
+		a->mappingSize = size + (hugePages == HUGEPAGES_TRANSPARENT ? HUGEPAGE_SIZE : 0);
+		a->mapping = mmap(NULL, a->mappingSize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(a->mapping == MAP_FAILED){
+			ERROR("Storage cannot be allocated");
+		}
+	}
+
+	offset = 0;
+	if(hugePages == HUGEPAGES_TRANSPARENT){
+		offset = (HUGEPAGE_SIZE - ((size_t)a->mapping & (HUGEPAGE_SIZE - 1))) & (HUGEPAGE_SIZE - 1);
+#ifdef MADV_HUGEPAGE
+		if(madvise(a->mapping + offset, a->mappingSize - offset, MADV_HUGEPAGE) == 0){
+			a->hugePages = HUGEPAGES_TRANSPARENT;
+		}
+#endif
+	}
+	a->base = a->mapping + offset;
+	a->size = a->mappingSize - offset;
+	a->used = 0;
+
+	/* Interleaving has to be set before the first touch of the pages */
+	if(numaPolicy == NUMA_INTERLEAVE){
+		memset(nodemask, 0, sizeof(nodemask));
+		if(readOnlineNodes(nodemask) > 1 &&
+				syscall(SYS_mbind, a->base, a->size, ARENA_MPOL_INTERLEAVE, nodemask,
+						(unsigned long)ARENA_MAX_NODES, 0U) == 0){
+			a->numaPolicy = NUMA_INTERLEAVE;
+		}
+		else{
+			printf("Arena: interleaving not possible (single node or no NUMA support), using first touch\n");
+		}
+	}
+}
+
+void *arenaAlloc(arena *a, size_t bytes){
+	char *field;
+
+	/* Every field starts on its own cache line */
+	a->used = (a->used + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+	if(a->used + bytes > a->size){
+		ERROR("Arena is too small for the requested field");
+	}
+	field = a->base + a->used;
+	a->used += bytes;
+	return field;
+}
+
+/* The huge pages actually backing the arena are read from /proc/self/smaps, which lists the
+ * AnonHugePages (transparent) and the hugetlb pages of every mapping. */
+void arenaReport(const arena *a){
+	FILE *fp = fopen("/proc/self/smaps", "r");
+	char line[256];
+	unsigned long start, end;
+	unsigned long hugeKb = 0, value;
+	int inArena = 0;
+	size_t alignment = ARENA_ALIGNMENT;
+
+	if(fp != NULL){
+		while(fgets(line, sizeof(line), fp) != NULL){
+			if(sscanf(line, "%lx-%lx ", &start, &end) == 2){
+				inArena = (start < (unsigned long)(a->mapping + a->mappingSize) && end > (unsigned long)a->mapping);
+			}
+			else if(inArena && (sscanf(line, "AnonHugePages: %lu kB", &value) == 1 ||
+					sscanf(line, "Private_Hugetlb: %lu kB", &value) == 1)){
+				hugeKb += value;
+			}
+		}
+		fclose(fp);
+	}
+
+	/* The largest power of two dividing the base address is the alignment that was obtained */
+	while(((size_t)a->base & (2*alignment - 1)) == 0 && alignment < HUGEPAGE_SIZE){
+		alignment *= 2;
+	}
+
+	printf("Arena: %lu MB for the fields, base aligned to %lu bytes, fields aligned to %i bytes\n",
+			(unsigned long)(a->used >> 20), (unsigned long)alignment, ARENA_ALIGNMENT);
+	printf("Arena: huge pages %s, %lu MB backed by huge pages, NUMA policy %s\n",
+			hugePageNames[a->hugePages], hugeKb >> 10, numaNames[a->numaPolicy]);
+}
+
+void arenaDestroy(arena *a){
+	if(a->mapping != NULL){
+		munmap(a->mapping, a->mappingSize);
+	}
+	memset(a, 0, sizeof(arena));
+}
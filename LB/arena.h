@@ -0,0 +1,43 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* alignment of every field taken from the arena (one cache line, also the AVX-512 width) */
+#define ARENA_ALIGNMENT 64
+
+/* huge page modes. Parameter name: "hugePages" */
+#define HUGEPAGES_NONE 0
+#define HUGEPAGES_TRANSPARENT 1
+#define HUGEPAGES_EXPLICIT 2
+
+/* NUMA placement policies. Parameter name: "numaPolicy" */
+#define NUMA_FIRSTTOUCH 0
+#define NUMA_INTERLEAVE 1
+
+/** one memory mapping from which all LB fields are taken */
+typedef struct {
+	char *mapping;          /* start of the mapping as returned by mmap */
+	size_t mappingSize;     /* length of the mapping */
+	char *base;             /* first usable byte, aligned to the huge page size if requested */
+	size_t size;            /* usable bytes from base */
+	size_t used;            /* bytes handed out by arenaAlloc */
+	int hugePages;          /* huge page mode that was actually obtained */
+	int numaPolicy;         /* NUMA policy that was actually obtained */
+} arena;
+
+/** maps 'size' bytes for the fields. The huge page and NUMA settings are requests, the arena
+ *  falls back to what the system offers and records what was obtained. */
+void arenaCreate(arena *a, size_t size, int hugePages, int numaPolicy);
+
+/** returns 'bytes' bytes of the arena aligned to ARENA_ALIGNMENT */
+void *arenaAlloc(arena *a, size_t bytes);
+
+/** prints alignment, huge page and NUMA placement that were obtained. Call it after the fields
+ *  were initialised, since pages (and transparent huge pages) only exist once they are touched. */
+void arenaReport(const arena *a);
+
+/** releases all fields of the arena at once */
+void arenaDestroy(arena *a);
+
+#endif
@@ -1,234 +1,119 @@
 #include "boundary.h"
 #include "LBDefinitions.h"
 #include "computeCellValues.h"
+#include "helper.h"
 #include <stdio.h>
 
-/* treatBoundary
- Carries out the boundary treatment. Therefore, we loop over the outer boundary cells, check
- each cell for its state (NO SLIP or MOVING WALL), and set the respective distribution
- functions inside this cell according to Eq.(16) and Eq.(18).
+/* compileBoundaryLinks
+ Loops once over all cells and finds, for each boundary cell (NO SLIP or MOVING WALL), the
+ directions i pointing to a fluid cell. The distribution i of the boundary cell is set in every
+ timestep from the inverse direction Q-i-1 of the fluid neighbour according to Eq.(16), and for
+ the moving wall with the additional term of Eq.(18), whose constant part is precomputed here.
  */
-void treatBoundary(double *collideField, int* flagField, const double * const wallVelocity, int xlength){
+void compileBoundaryLinks(const int * const flagField, const double * const wallVelocity, int xlength,
+		boundaryLinks *links){
 	int x, y, z;
+	int nx, ny, nz;
 	int i;
-	double density;
-	int counter;
-	int counter_wall;
-    
-	/*The following array are the values for i that are pointing in the direction of the inner cells
-	 * for example in the border where y = 0, the c vectors pointing inside must be the ones which
-	 * y component is = 1, in this case the ones with index 4, 11, 12, 13, 18, and the array is denoted
-	 * as y_min. The same case is for when y = xlength+1 and the array is y_max, and similarly for the
-	 * other 4 planes that form the border of the cube. */
-	int y_min[5]={4, 11, 12, 13, 18};
-	int y_max[5]={14, 7, 6, 5, 0};
-	int x_min[5]={3, 7, 10, 13, 17};
-	int x_max[5]={15, 11, 8, 5, 1};
-	int z_min[5]={14, 15, 16, 17, 18};
-	int z_max[5]={4, 3, 2, 1, 0};
-    
-	/*This is divided in 6 similar for loops for each of the planes, starting with the plane where y = 0*/
-	y = 0;
-	for(z = 0; z < xlength + 1; z++){
-		for(x = 0; x < xlength + 2; x++){
-			/* Store an index for the current cell */
-			counter = (z * (xlength+2) * (xlength+2) + y * (xlength+2) + x);
-			/* Check if the boundary condition is NO SLIP*/
-			if(flagField[counter]==1){
-				for(i = 0; i<5; i++){
-					/*Check that the updated directions are pointing to the inner cells*/
-					if(((x+LATTICEVELOCITIES[y_min[i]][0]) > 0) && ((z+LATTICEVELOCITIES[y_min[i]][2]) > 0) &&
-                       ((x+LATTICEVELOCITIES[y_min[i]][0])< xlength+1)&&((z+LATTICEVELOCITIES[y_min[i]][2])< xlength+1)){
-						collideField[Q*counter+y_min[i]]= collideField[Q*((z+LATTICEVELOCITIES[y_min[i]][2])*
-                                                                          (xlength+2) * (xlength+2) + (y+LATTICEVELOCITIES[y_min[i]][1]) * (xlength+2) +
-                                                                          (x+LATTICEVELOCITIES[y_min[i]][0]))+(Q-y_min[i]-1)] ;
-					}
-				}
-			}
-			if(flagField[counter]==2){
-				for(i = 0; i < 5; i++){
-					/* Check that there exists an inner cell in that direction*/
-					if(((x+LATTICEVELOCITIES[y_min[i]][0]) > 0) && ((z+LATTICEVELOCITIES[y_min[i]][2]) > 0) &&
-                       ((x+LATTICEVELOCITIES[y_min[i]][0])< xlength+1)&&((z+LATTICEVELOCITIES[y_min[i]][2])< xlength+1)){
-						/*treat the boundary as MOVING WALL according to Eq. (18)*/
-						counter_wall  = Q*((z+LATTICEVELOCITIES[y_min[i]][2]) * (xlength+2) * (xlength+2) +
-                                           (y+LATTICEVELOCITIES[y_min[i]][1]) * (xlength+2) + (x+LATTICEVELOCITIES[y_min[i]][0]));
-						computeDensity (&collideField[counter_wall] , &density) ;
-						collideField[Q*counter+y_min[i]]= collideField[counter_wall+(Q-y_min[i]-1)]+
-                        2*LATTICEWEIGHTS[y_min[i]]*density/(C_S*C_S)*((LATTICEVELOCITIES[y_min[i]][0]*wallVelocity[0])+
-                                                                      (LATTICEVELOCITIES[y_min[i]][1]*wallVelocity[1])+(LATTICEVELOCITIES[y_min[i]][2]*wallVelocity[2]));
-                        
-					}
-				}
-			}
-		}
-	}
-    
-	y = xlength+1;
-	for(z = 0; z < xlength + 1; z++){
-		for(x = 0; x < xlength + 2; x++){
-			counter = (z * (xlength+2) * (xlength+2) + y * (xlength+2) + x);
-			if(flagField[counter]==1){
-				for(i = 0; i<5; i++){
-					if(((x+LATTICEVELOCITIES[y_max[i]][0]) > 0) && ((z+LATTICEVELOCITIES[y_max[i]][2]) > 0) &&
-                       ((x+LATTICEVELOCITIES[y_max[i]][0])< xlength+1)&&((z+LATTICEVELOCITIES[y_max[i]][2])< xlength+1)){
-						collideField[Q*counter+y_max[i]]= collideField[Q*((z+LATTICEVELOCITIES[y_max[i]][2])*
-                                                                          (xlength+2) * (xlength+2) + (y+LATTICEVELOCITIES[y_max[i]][1]) * (xlength+2) +
-                                                                          (x+LATTICEVELOCITIES[y_max[i]][0]))+(Q-y_max[i]-1)] ;
-					}
-				}
-			}
-			if(flagField[counter]==2){
-				for(i = 0; i < 5; i++){
-					if(((x+LATTICEVELOCITIES[y_max[i]][0]) > 0) && ((z+LATTICEVELOCITIES[y_max[i]][2]) > 0) &&
-                       ((x+LATTICEVELOCITIES[y_max[i]][0])< xlength+1)&&((z+LATTICEVELOCITIES[y_max[i]][2])< xlength+1)){
-						counter_wall  = Q*((z+LATTICEVELOCITIES[y_max[i]][2]) * (xlength+2) * (xlength+2) +
-                                           (y+LATTICEVELOCITIES[y_max[i]][1]) * (xlength+2) + (x+LATTICEVELOCITIES[y_max[i]][0]));
-						computeDensity (&collideField[counter_wall] , &density) ;
-						collideField[Q*counter+y_max[i]]= collideField[counter_wall+(Q-y_max[i]-1)]+
-                        2*LATTICEWEIGHTS[y_max[i]]*density/(C_S*C_S)*((LATTICEVELOCITIES[y_max[i]][0]*wallVelocity[0])+
-                                                                      (LATTICEVELOCITIES[y_max[i]][1]*wallVelocity[1])+(LATTICEVELOCITIES[y_max[i]][2]*wallVelocity[2]));
-                        
-					}
-				}
-			}
-		}
-	}
-    
-	x = 0;
-	for(z = 0; z < xlength + 1; z++){
-		for(y = 0; y < xlength + 2; y++){
-			counter = (z * (xlength+2) * (xlength+2) + y * (xlength+2) + x);
-			if(flagField[counter]==1){
-				for(i = 0; i<5; i++){
-					if(((y+LATTICEVELOCITIES[x_min[i]][1]) > 0) && ((z+LATTICEVELOCITIES[x_min[i]][2]) > 0) &&
-                       ((y+LATTICEVELOCITIES[x_min[i]][1])< xlength+1)&&((z+LATTICEVELOCITIES[x_min[i]][2])< xlength+1)){
-						collideField[Q*counter+x_min[i]]= collideField[Q*((z+LATTICEVELOCITIES[x_min[i]][2])*
-                                                                          (xlength+2) * (xlength+2) + (y+LATTICEVELOCITIES[x_min[i]][1]) * (xlength+2) +
-                                                                          (x+LATTICEVELOCITIES[x_min[i]][0]))+(Q-x_min[i]-1)] ;
-					}
-				}
-			}
-			if(flagField[counter]==2){
-				for(i = 0; i < 5; i++){
-					/* Check that there exists a neighbor cell in that direction*/
-					if(((y+LATTICEVELOCITIES[x_min[i]][1]) > 0) && ((z+LATTICEVELOCITIES[x_min[i]][2]) > 0) &&
-                       ((y+LATTICEVELOCITIES[x_min[i]][1])< xlength+1)&&((z+LATTICEVELOCITIES[x_min[i]][2])< xlength+1)){
-						/*treat the boundary as MOVING WALL according to Eq. (18)*/
-						counter_wall  = Q*((z+LATTICEVELOCITIES[x_min[i]][2]) * (xlength+2) * (xlength+2) +
-                                           (y+LATTICEVELOCITIES[x_min[i]][1]) * (xlength+2) + (x+LATTICEVELOCITIES[x_min[i]][0]));
-						computeDensity (&collideField[counter_wall] , &density) ;
-						collideField[Q*counter+x_min[i]]= collideField[counter_wall+(Q-x_min[i]-1)]+
-                        2*LATTICEWEIGHTS[x_min[i]]*density/(C_S*C_S)*((LATTICEVELOCITIES[x_min[i]][0]*wallVelocity[0])+
-                                                                      (LATTICEVELOCITIES[x_min[i]][1]*wallVelocity[1])+(LATTICEVELOCITIES[x_min[i]][2]*wallVelocity[2]));
-                        
-					}
-				}
+	int pass;
+	int cell;
+	int neighbour;
+	int numNoSlip = 0;
+	int numMoving = 0;
+
+	links->numNoSlip = 0;
+	links->numMoving = 0;
+
+	/* The first pass counts the links, the second one stores them */
+	for(pass = 0; pass < 2; pass++){
+		if(pass == 1){
+			links->noSlipDst = (int *) malloc((size_t)(numNoSlip+1)*sizeof(int));
+			links->noSlipSrc = (int *) malloc((size_t)(numNoSlip+1)*sizeof(int));
+			links->movingDst = (int *) malloc((size_t)(numMoving+1)*sizeof(int));
+			links->movingSrc = (int *) malloc((size_t)(numMoving+1)*sizeof(int));
+			links->movingCell = (int *) malloc((size_t)(numMoving+1)*sizeof(int));
+			links->movingCoefficient = (double *) malloc((size_t)(numMoving+1)*sizeof(double));
+			if(links->noSlipDst == NULL || links->noSlipSrc == NULL || links->movingDst == NULL ||
+					links->movingSrc == NULL || links->movingCell == NULL || links->movingCoefficient == NULL){
+				ERROR("Storage cannot be allocated");
 			}
 		}
-	}
-    
-	x = xlength+1;
-	for(z = 0; z < xlength + 1; z++){
-		for(y = 0; y < xlength + 2; y++){
-			counter = (z * (xlength+2) * (xlength+2) + y * (xlength+2) + x);
-			if(flagField[counter]==1){
-				for(i = 0; i<5; i++){
-					if(((y+LATTICEVELOCITIES[x_max[i]][1]) > 0) && ((z+LATTICEVELOCITIES[x_max[i]][2]) > 0) &&
-                       ((y+LATTICEVELOCITIES[x_max[i]][1])< xlength+1)&&((z+LATTICEVELOCITIES[x_max[i]][2])< xlength+1)){
-						collideField[Q*counter+x_max[i]]= collideField[Q*((z+LATTICEVELOCITIES[x_max[i]][2])*
-                                                                          (xlength+2) * (xlength+2) + (y+LATTICEVELOCITIES[x_max[i]][1]) * (xlength+2) +
-                                                                          (x+LATTICEVELOCITIES[x_max[i]][0]))+(Q-x_max[i]-1)] ;
-					}
-				}
-			}
-			if(flagField[counter]==2){
-				for(i = 0; i < 5; i++){
-					/* Check that there exists a neighbor cell in that direction*/
-					if(((y+LATTICEVELOCITIES[x_max[i]][1]) > 0) && ((z+LATTICEVELOCITIES[x_max[i]][2]) > 0) &&
-                       ((y+LATTICEVELOCITIES[x_max[i]][1])< xlength+1)&&((z+LATTICEVELOCITIES[x_max[i]][2])< xlength+1)){
-						/*treat the boundary as MOVING WALL according to Eq. (18)*/
-						counter_wall  = Q*((z+LATTICEVELOCITIES[x_max[i]][2]) * (xlength+2) * (xlength+2) +
-                                           (y+LATTICEVELOCITIES[x_max[i]][1]) * (xlength+2) + (x+LATTICEVELOCITIES[x_max[i]][0]));
-						computeDensity (&collideField[counter_wall] , &density) ;
-						collideField[Q*counter+x_max[i]]= collideField[counter_wall+(Q-x_max[i]-1)]+
-                        2*LATTICEWEIGHTS[x_max[i]]*density/(C_S*C_S)*((LATTICEVELOCITIES[x_max[i]][0]*wallVelocity[0])+
-                                                                      (LATTICEVELOCITIES[x_max[i]][1]*wallVelocity[1])+(LATTICEVELOCITIES[x_max[i]][2]*wallVelocity[2]));
-                        
+		for(z = 0; z < xlength + 2; z++){
+			for(y = 0; y < xlength + 2; y++){
+				for(x = 0; x < xlength + 2; x++){
+					cell = z * (xlength+2) * (xlength+2) + y * (xlength+2) + x;
+					if(flagField[cell] == FLUID){
+						continue;
 					}
-				}
-			}
-		}
-	}
-    
-	z = 0;
-	for(y = 0; y < xlength + 2; y++){
-		for(x = 0; x < xlength + 2; x++){
-			counter = (z * (xlength+2) * (xlength+2) + y * (xlength+2) + x);
-			if(flagField[counter]==1){
-				for(i = 0; i<5; i++){
-					if(((x+LATTICEVELOCITIES[z_min[i]][0]) > 0) && ((y+LATTICEVELOCITIES[z_min[i]][1]) > 0) &&
-                       ((x+LATTICEVELOCITIES[z_min[i]][0])< xlength+1)&&((y+LATTICEVELOCITIES[z_min[i]][1])< xlength+1)){
-						collideField[Q*counter+z_min[i]]= collideField[Q*((z+LATTICEVELOCITIES[z_min[i]][2])*
-                                                                          (xlength+2) * (xlength+2) + (y+LATTICEVELOCITIES[z_min[i]][1]) * (xlength+2) +
-                                                                          (x+LATTICEVELOCITIES[z_min[i]][0]))+(Q-z_min[i]-1)] ;
-						if(collideField[Q*counter+z_max[i]]<0 ||collideField[Q*counter+z_max[i]] > 2 ){
-						printf("x=%i y=%i z=%i value=%f\n",x,y,z,collideField[Q*counter+z_min[i]]);
+					for(i = 0; i < Q; i++){
+						nx = x + LATTICEVELOCITIES[i][0];
+						ny = y + LATTICEVELOCITIES[i][1];
+						nz = z + LATTICEVELOCITIES[i][2];
+						/* Only directions pointing to a fluid cell inside the lattice get a link */
+						if(nx < 0 || ny < 0 || nz < 0 || nx > xlength+1 || ny > xlength+1 || nz > xlength+1){
+							continue;
 						}
-					}
-				}
-			}
-			
-			if(flagField[counter]==2){
-				for(i = 0; i < 5; i++){
-					/* Check that there exists a neighbor cell in that direction*/
-					if(((x+LATTICEVELOCITIES[z_min[i]][0]) > 0) && ((y+LATTICEVELOCITIES[z_min[i]][1]) > 0) &&
-                       ((x+LATTICEVELOCITIES[z_min[i]][0])< xlength+1)&&((y+LATTICEVELOCITIES[z_min[i]][1])< xlength+1)){
-						/*treat the boundary as MOVING WALL according to Eq. (18)*/
-						counter_wall  = Q*((z+LATTICEVELOCITIES[z_min[i]][2]) * (xlength+2) * (xlength+2) +
-                                           (y+LATTICEVELOCITIES[z_min[i]][1]) * (xlength+2) + (x+LATTICEVELOCITIES[z_min[i]][0]));
-						computeDensity (&collideField[counter_wall] , &density) ;
-						collideField[Q*counter+z_min[i]]= collideField[counter_wall+(Q-z_min[i]-1)]+
-                        2*LATTICEWEIGHTS[z_min[i]]*density/(C_S*C_S)*((LATTICEVELOCITIES[z_min[i]][0]*wallVelocity[0])+
-                                                                      (LATTICEVELOCITIES[z_min[i]][1]*wallVelocity[1])+(LATTICEVELOCITIES[z_min[i]][2]*wallVelocity[2]));
-                        if(collideField[Q*counter+z_max[i]]<0 ||collideField[Q*counter+z_max[i]] > 2 ){
-						printf("x=%i y=%i z=%i value=%f\n",x,y,z,collideField[Q*counter+z_min[i]]);
+						neighbour = nz * (xlength+2) * (xlength+2) + ny * (xlength+2) + nx;
+						if(flagField[neighbour] != FLUID){
+							continue;
+						}
+						if(flagField[cell] == MOVING_WALL){
+							if(pass == 1){
+								links->movingDst[links->numMoving] = Q*cell + i;
+								links->movingSrc[links->numMoving] = Q*neighbour + (Q-i-1);
+								links->movingCell[links->numMoving] = Q*neighbour;
+								links->movingCoefficient[links->numMoving] = 2*LATTICEWEIGHTS[i]/(C_S*C_S)*
+										((LATTICEVELOCITIES[i][0]*wallVelocity[0])+(LATTICEVELOCITIES[i][1]*wallVelocity[1])+
+										(LATTICEVELOCITIES[i][2]*wallVelocity[2]));
+								links->numMoving++;
+							}
+							else{
+								numMoving++;
+							}
+						}
+						else{
+							if(pass == 1){
+								links->noSlipDst[links->numNoSlip] = Q*cell + i;
+								links->noSlipSrc[links->numNoSlip] = Q*neighbour + (Q-i-1);
+								links->numNoSlip++;
+							}
+							else{
+								numNoSlip++;
+							}
 						}
 					}
 				}
 			}
 		}
 	}
-    
-	z = xlength+1;
-	for(y = 0; y < xlength + 2; y++){
-		for(x = 0; x < xlength + 2; x++){
-			counter = (z * (xlength+2) * (xlength+2) + y * (xlength+2) + x);
-			if(flagField[counter]==1){
-				for(i = 0; i<5; i++){
-					if(((x+LATTICEVELOCITIES[z_max[i]][0]) > 0) && ((y+LATTICEVELOCITIES[z_max[i]][1]) > 0) &&
-                       ((x+LATTICEVELOCITIES[z_max[i]][0])< xlength+1)&&((y+LATTICEVELOCITIES[z_max[i]][1])< xlength+1)){
-						collideField[Q*counter+z_max[i]]= collideField[Q*((z+LATTICEVELOCITIES[z_max[i]][2])*
-                                                                          (xlength+2) * (xlength+2) + (y+LATTICEVELOCITIES[z_max[i]][1]) * (xlength+2) +
-                                                                          (x+LATTICEVELOCITIES[z_max[i]][0]))+(Q-z_max[i]-1)] ;
-					}
-				}
-			}
-			if(flagField[counter]==2){
-				for(i = 0; i < 5; i++){
-					/* Check that there exists a neighbor cell in that direction*/
-					if(((x+LATTICEVELOCITIES[z_max[i]][0]) > 0) && ((y+LATTICEVELOCITIES[z_max[i]][1]) > 0) &&
-                       ((x+LATTICEVELOCITIES[z_max[i]][0]) < xlength+1)&&((y+LATTICEVELOCITIES[z_max[i]][1])< xlength+1)){
-						/*treat the boundary as MOVING WALL according to Eq. (18)*/
-						counter_wall  = Q*((z+LATTICEVELOCITIES[z_max[i]][2]) * (xlength+2) * (xlength+2) +
-                                           (y+LATTICEVELOCITIES[z_max[i]][1]) * (xlength+2) + (x+LATTICEVELOCITIES[z_max[i]][0]));
-						computeDensity (&collideField[counter_wall] , &density) ;						
-						collideField[Q*counter+z_max[i]]= collideField[counter_wall+(Q-z_max[i]-1)]+
-                        2*LATTICEWEIGHTS[z_max[i]]*density/(C_S*C_S)*((LATTICEVELOCITIES[z_max[i]][0]*wallVelocity[0])+
-                                                                      (LATTICEVELOCITIES[z_max[i]][1]*wallVelocity[1])+(LATTICEVELOCITIES[z_max[i]][2]*wallVelocity[2]));					
-					}
-				}
-			}
-		}
+	printf("Boundary links: %i no slip, %i moving wall\n", links->numNoSlip, links->numMoving);
+}
+
+void freeBoundaryLinks(boundaryLinks *links){
+	free(links->noSlipDst);
+	free(links->noSlipSrc);
+	free(links->movingDst);
+	free(links->movingSrc);
+	free(links->movingCell);
+	free(links->movingCoefficient);
+}
+
+/* treatBoundary
+ Carries out the boundary treatment with the precompiled links: the NO SLIP links are a plain
+ gather according to Eq.(16), the MOVING WALL links add the wall term of Eq.(18) scaled with the
+ density of the fluid cell.
+ */
+void treatBoundary(double *collideField, const boundaryLinks * const links){
+	int k;
+	double density;
+	const int * const noSlipDst = links->noSlipDst;
+	const int * const noSlipSrc = links->noSlipSrc;
+
+	for(k = 0; k < links->numNoSlip; k++){
+		collideField[noSlipDst[k]] = collideField[noSlipSrc[k]];
+	}
+	for(k = 0; k < links->numMoving; k++){
+		computeDensity(&collideField[links->movingCell[k]], &density);
+		collideField[links->movingDst[k]] = collideField[links->movingSrc[k]] + links->movingCoefficient[k]*density;
 	}
 }
@@ -1,8 +1,28 @@
 #ifndef _BOUNDARY_H_
 #define _BOUNDARY_H_
 
+/** bounce-back links between the boundary cells and their fluid neighbours. A link copies the
+ *  distribution src (pointing out of the fluid) to dst (the inverse direction in the boundary
+ *  cell). Moving wall links additionally add coefficient * density of the fluid cell cell. */
+typedef struct {
+	int numNoSlip;
+	int *noSlipDst;
+	int *noSlipSrc;
+	int numMoving;
+	int *movingDst;
+	int *movingSrc;
+	int *movingCell;
+	double *movingCoefficient;
+} boundaryLinks;
+
+/** collects the bounce-back links of every boundary cell in the flag field once at startup */
+void compileBoundaryLinks(const int * const flagField, const double * const wallVelocity, int xlength,
+		boundaryLinks *links);
+
+/** frees the link lists */
+void freeBoundaryLinks(boundaryLinks *links);
+
 /** handles the boundaries in our simulation setup */
-void treatBoundary(double *collideField, int* flagField, const double * const wallVelocity,int xlength);
+void treatBoundary(double *collideField, const boundaryLinks * const links);
 
 #endif
-
@@ -27,6 +27,10 @@ void doCollision(double *collideField, int *flagField,const double * const tau,i
 	for (z = 1; z < xlength+1; z++) {
 		for (y = 1; y < xlength+1; y++) {
 			for (x = 1; x < xlength+1; x++) {
+                /* obstacle cells are skipped */
+				if(flagField[z*(xlength+2)*(xlength+2) + y * (xlength+2) + x] != FLUID){
+					continue;
+				}
                 /* get the current index */
 				counter  = Q*(z*(xlength+2)*(xlength+2) + y * (xlength+2) + x );
 				/* Compute density, velocity, f_eq to finally get the postcollision distribution */
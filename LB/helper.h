@@ -104,6 +104,13 @@ void read_string( const char* szFilename, const char* szName, char*  sValue);
 void read_int   ( const char* szFilename, const char* szName, int*    nValue);
 void read_double( const char* szFilename, const char* szName, double*  Value);
 
+/**
+ * Returns the value string of the line defining szVarName in the data file.
+ * The pointer refers to a static buffer, so the string has to be copied or
+ * parsed before the next call.
+ */
+char* find_string( const char* szFileName, const char *szVarName );
+
 
 /**
  * Writing matrices to a file.
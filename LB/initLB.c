@@ -1,6 +1,10 @@
 #include "initLB.h"
 #include "helper.h"
 #include "LBDefinitions.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* reads the parameters for the lid driven cavity scenario from a config file */
 int readParameters(
@@ -9,6 +13,11 @@ int readParameters(
 		double *velocityWall,
 		int *timesteps,
 		int *timestepsPerPlotting,
+		int *vtkPieces,
+		int *hugePages,
+		int *numaPolicy,
+		char *geometryFile,
+		int *perfCounters,
 		int argc,
 		char *argv
 ){
@@ -21,6 +30,11 @@ int readParameters(
 		READ_INT( argv, *xlength );
 		READ_INT ( argv, *timesteps);
 		READ_INT( argv, *timestepsPerPlotting);
+		READ_INT( argv, *vtkPieces);
+		READ_INT( argv, *hugePages);
+		READ_INT( argv, *numaPolicy);
+		READ_STRING( argv, geometryFile);
+		READ_INT( argv, *perfCounters);
 		READ_DOUBLE( argv, *tau );
 		/* Since the velocity is a vector of 1 x 3, we read the three different values and then save them in one array */
 		READ_DOUBLE( argv, velocityWallx);
@@ -39,7 +53,7 @@ int readParameters(
 }
 
 /* Initialises the particle distribution function fields collideField, flagField and streamField. */
-void initialiseFields(double *collideField, double *streamField, int *flagField, int xlength){
+void initialiseFields(double *collideField, double *streamField, int *flagField, int xlength, const char *geometryFile){
 	/*i-th distribution function in the cell (x, y, z) is (Q * (z * xlength * xlength + y * xlength + x)) + i; */
 	int i, x, y, z;
 
@@ -47,7 +61,7 @@ void initialiseFields(double *collideField, double *streamField, int *flagField,
 	for (z = 0; z < xlength + 2; z++){
 		for (y = 0; y < xlength + 2; y++){
 			for (x = 0; x < xlength + 2; x++){
-				flagField[((z * (xlength+2) * (xlength+2) + y * (xlength+2) + x))] = 0;
+				flagField[((z * (xlength+2) * (xlength+2) + y * (xlength+2) + x))] = FLUID;
 			}
 		}
 	}
@@ -55,38 +69,46 @@ void initialiseFields(double *collideField, double *streamField, int *flagField,
 
 	for (z = 0; z < xlength + 2; z++){
 		for (y = 0; y < xlength + 2; y++){
-			flagField[((z * (xlength+2) * (xlength+2) + y * (xlength+2) ))] = 1;
+			flagField[((z * (xlength+2) * (xlength+2) + y * (xlength+2) ))] = NO_SLIP;
 		}
 	}
 	for (z = 0; z < xlength + 2; z++){
 		for (y = 0; y < xlength + 2; y++){
-			flagField[((z * (xlength+2) * (xlength+2) + y * (xlength+2) + (xlength+1)))] = 1;
+			flagField[((z * (xlength+2) * (xlength+2) + y * (xlength+2) + (xlength+1)))] = NO_SLIP;
 		}
 	}
 	for (z = 0; z < xlength + 2; z++){
 		for (x = 0; x < xlength + 2; x++){
-			flagField[((z * (xlength+2) * (xlength+2) + x))] = 1;
+			flagField[((z * (xlength+2) * (xlength+2) + x))] = NO_SLIP;
 		}
 	}
 
 	for (z = 0; z < xlength + 2; z++){
 		for (x = 0; x < xlength + 2; x++){
-			flagField[((z * (xlength+2) * (xlength+2) + (xlength+1) * (xlength+2) + x))] = 1;
+			flagField[((z * (xlength+2) * (xlength+2) + (xlength+1) * (xlength+2) + x))] = NO_SLIP;
 		}
 	}
 
 	for (y = 0; y < xlength + 2; y++){
 		for (x = 0; x < xlength + 2; x++){
-			flagField[((y * (xlength+2) + x))] = 1;
+			flagField[((y * (xlength+2) + x))] = NO_SLIP;
 		}
 	}
 
 	for (y = 0; y < xlength + 2; y++){
 		for (x = 0; x < xlength + 2; x++){
-			flagField[(((xlength+1) * (xlength+2) * (xlength+2) + y * (xlength+2) + x))] = 2;
+			flagField[(((xlength+1) * (xlength+2) * (xlength+2) + y * (xlength+2) + x))] = MOVING_WALL;
 		}
 	}
 
+	/* Obstacles inside the cavity are read from the voxel file */
+	if(strcmp(geometryFile, "none") != 0){
+		readGeometry(geometryFile, flagField, xlength);
+	}
+
+	/* This is the first touch of the populations, so it is done in parallel slabs of z to place
+	 * the pages on the NUMA node of the thread working on them */
+	#pragma omp parallel for private(y, x, i) schedule(static)
 	for (z = 0; z < xlength + 2; z++){
 		for (y = 0; y < xlength + 2; y++){
 			for (x = 0; x < xlength + 2; x++){
@@ -105,4 +127,46 @@ void initialiseFields(double *collideField, double *streamField, int *flagField,
 
 }
 
+/* Reads the voxel file. The file is memory mapped, so large geometries are paged in while they
+ * are scanned and never copied as a whole. */
+void readGeometry(const char *geometryFile, int *flagField, int xlength){
+	int x, y, z;
+	int fd;
+	struct stat fileInfo;
+	const unsigned char *voxels;
+	size_t numVoxels = (size_t)xlength*xlength*xlength;
+	size_t v = 0;
+	int numObstacles = 0;
+	char szBuff[200];
+
+	fd = open(geometryFile, O_RDONLY);
+	if(fd < 0 || fstat(fd, &fileInfo) != 0){
+		sprintf(szBuff, "Can not read geometry file %.100s", geometryFile);
+		ERROR(szBuff);
+	}
+	if((size_t)fileInfo.st_size != numVoxels){
+		sprintf(szBuff, "Geometry file has %ld bytes, expected xlength^3 = %lu", (long)fileInfo.st_size,
+				(unsigned long)numVoxels);
+		ERROR(szBuff);
+	}
+	voxels = (const unsigned char *) mmap(NULL, numVoxels, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(voxels == MAP_FAILED){
+		ERROR("Can not map geometry file");
+	}
+	madvise((void *)voxels, numVoxels, MADV_SEQUENTIAL);
+
+	for (z = 1; z < xlength + 1; z++){
+		for (y = 1; y < xlength + 1; y++){
+			for (x = 1; x < xlength + 1; x++){
+				if(voxels[v++]){
+					flagField[z * (xlength+2) * (xlength+2) + y * (xlength+2) + x] = NO_SLIP;
+					numObstacles++;
+				}
+			}
+		}
+	}
+	printf("Geometry: %i obstacle cells read from %s\n", numObstacles, geometryFile);
 
+	munmap((void *)voxels, numVoxels);
+	close(fd);
+}
@@ -12,13 +12,22 @@ double *tau,                        /* relaxation parameter tau. Parameter name:
 double *velocityWall,               /* velocity of the lid. Parameter name: "characteristicvelocity" */
 int *timesteps,            			/* number of timesteps. Parameter name: "timesteps" */
 int *timestepsPerPlotting, 			/* timesteps between subsequent VTK plots. Parameter name: "vtkoutput" */
+int *vtkPieces,                     /* pieces of the parallel .pvti output, 0 writes one legacy .vtk file. Parameter name: "vtkPieces" */
+int *hugePages,                     /* huge pages for the fields (0: none 1: transparent 2: explicit). Parameter name: "hugePages" */
+int *numaPolicy,                    /* NUMA placement of the fields (0: first touch 1: interleave). Parameter name: "numaPolicy" */
+char *geometryFile,                 /* binary voxel file with the obstacles or "none". Parameter name: "geometryFile" */
+int *perfCounters,                  /* read hardware counters per phase (0: timers only 1: counters). Parameter name: "perfCounters" */
 int argc,                           /* number of arguments. Should equal 2 (program + name of config file */
 char *argv                          /* argv[1] shall contain the path to the config file */
 );
 
 
 /* initialises the particle distribution functions and the flagfield */
-void initialiseFields(double *collideField, double *streamField,int *flagField, int xlength);
+void initialiseFields(double *collideField, double *streamField,int *flagField, int xlength, const char *geometryFile);
+
+/* marks the obstacle cells of a binary voxel file in the flagfield. The file holds one byte per
+ * inner cell (x fastest, then y, then z), every non-zero byte is a NO SLIP cell. */
+void readGeometry(const char *geometryFile, int *flagField, int xlength);
 
 #endif
 
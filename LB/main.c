@@ -11,6 +11,8 @@
 #include "helper.h"
 #include "visualLB.h"
 #include "boundary.h"
+#include "arena.h"
+#include "perfCounters.h"
 #include "math.h"
 
 
@@ -23,44 +25,91 @@ int main (int argc, char *argv[]){
 	double velocityWall[3];
 	int timesteps;
 	int timestepsPerPlotting;
+	int vtkPieces;
+	int hugePages;
+	int numaPolicy;
+	char geometryFile[MAX_LINE_LENGTH];
+	boundaryLinks links;
+	int perfCounters;
+	phaseCounters phases;
+	arena fieldArena;
+	size_t numCells;
 	int t;
+	outputRegion *regions=NULL;
+	int numRegions;
+	int k;
 
-	if(readParameters(&xlength, &tau, velocityWall, &timesteps, &timestepsPerPlotting, argc , argv[1])==1){
+	if(readParameters(&xlength, &tau, velocityWall, &timesteps, &timestepsPerPlotting, &vtkPieces, &hugePages, &numaPolicy, geometryFile, &perfCounters, argc , argv[1])==1){
 
-		/* Allocate memory for the collide, stream and flag fields */
-		collideField = (double *)  malloc((size_t)( Q *(xlength+2)*(xlength+2) *(xlength+2)* sizeof( double )));
-		streamField = (double *)  malloc((size_t)( Q *(xlength+2)*(xlength+2) *(xlength+2)* sizeof( double )));
-		flagField = (int *) malloc((size_t)(xlength+2)*(xlength+2) *(xlength+2)* sizeof( int ));
+		/* Allocate memory for the collide, stream and flag fields from one aligned arena */
+		numCells = (size_t)(xlength+2)*(xlength+2)*(xlength+2);
+		arenaCreate(&fieldArena, 2*Q*numCells*sizeof(double) + numCells*sizeof(int) + 3*ARENA_ALIGNMENT,
+				hugePages, numaPolicy);
+		collideField = (double *) arenaAlloc(&fieldArena, Q*numCells*sizeof(double));
+		streamField = (double *) arenaAlloc(&fieldArena, Q*numCells*sizeof(double));
+		flagField = (int *) arenaAlloc(&fieldArena, numCells*sizeof(int));
 
+		/* Read the slices and sub-boxes that are written additionally to the full field */
+		numRegions = readOutputRegions(argv[1], &regions, xlength);
 
 		/* Initialise the fields with lattice weights and with the corresponding flags and check that there was no errors*/
 
-		initialiseFields(collideField,streamField,flagField,xlength);
+		initialiseFields(collideField,streamField,flagField,xlength,geometryFile);
+		arenaReport(&fieldArena);
+
+		/* The geometry is static, so the bounce-back links are compiled only once */
+		compileBoundaryLinks(flagField,velocityWall,xlength,&links);
+
+		/* Time (and optionally count) the phases of the timesteps */
+		initPhaseCounters(&phases, perfCounters);
 
 		/* Run this cycle for the number of timesteps required */
 		for(t = 0; t < timesteps; t++){
 			/* Create a temporary pointer to store swap the stream and collide pointers */
 			double *swap=NULL;
 			/* Do the streaming step using the collide field as input */
+			startPhase(&phases, PHASE_STREAMING);
 			doStreaming(collideField,streamField,flagField,xlength);
+			stopPhase(&phases, PHASE_STREAMING);
 			/* Swap the streaming field with the collide field */
 			swap = collideField;
 			collideField = streamField;
 			streamField = swap;
 			/* Do the collision step */
+			startPhase(&phases, PHASE_COLLISION);
 			doCollision(collideField,flagField,&tau,xlength);
+			stopPhase(&phases, PHASE_COLLISION);
 			/* Do the boundary treatment */
-			treatBoundary(collideField,flagField,velocityWall,xlength);
-			/* Create the output file depending on how many timesteps are defined */
-			if (t%timestepsPerPlotting==0){
-				writeVtkOutput(collideField,flagField,argv[0],t,xlength);
+			startPhase(&phases, PHASE_BOUNDARY);
+			treatBoundary(collideField,&links);
+			stopPhase(&phases, PHASE_BOUNDARY);
+			/* Create the output file depending on how many timesteps are defined.
+			 * The full field output can be switched off with timestepsPerPlotting <= 0 */
+			startPhase(&phases, PHASE_OUTPUT);
+			if (timestepsPerPlotting > 0 && t%timestepsPerPlotting==0){
+				if(vtkPieces > 0){
+					writeVtiOutput(collideField,flagField,argv[0],t,xlength,vtkPieces);
+				}
+				else{
+					writeVtkOutput(collideField,flagField,argv[0],t,xlength);
+				}
 			}
+			/* Each output region has its own file and interval */
+			for(k = 0; k < numRegions; k++){
+				if(t%regions[k].interval==0){
+					writeVtkRegion(collideField,flagField,argv[0],t,xlength,&regions[k],k);
+				}
+			}
+			stopPhase(&phases, PHASE_OUTPUT);
 		}
 
+		reportPhaseCounters(&phases, (double)xlength*xlength*xlength);
+		closePhaseCounters(&phases);
+
 		/*Kill the pointers*/
-		free(collideField);
-		free(streamField);
-		free(flagField);
+		freeBoundaryLinks(&links);
+		arenaDestroy(&fieldArena);
+		free(regions);
 	}
 return 0;
 }
@@ -0,0 +1,251 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "perfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* cache line size used to turn LLC misses into transferred bytes */
+#define CACHE_LINE_BYTES 64
+
+static const char *phaseNames[NUM_PHASES] = {"streaming", "collision", "boundary", "output"};
+static const char *counterNames[NUM_COUNTERS] = {"cycles", "instructions", "LLC references", "LLC misses"};
+
+#ifdef __linux__
+static const uint64_t counterConfig[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+
+/* opens one hardware counter of the calling thread, disabled until the group leader is enabled */
+static int openCounter(uint64_t config, int groupFd){
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = (groupFd == -1);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+/* opens the group of the calling thread with the counters that are available */
+static void openGroup(int *fd, const int *available){
+	int c;
+	for(c = 0; c < NUM_COUNTERS; c++){
+		fd[c] = -1;
+	}
+	fd[0] = openCounter(counterConfig[0], -1);
+	for(c = 1; c < NUM_COUNTERS && fd[0] >= 0; c++){
+		if(available[c]){
+			fd[c] = openCounter(counterConfig[c], fd[0]);
+		}
+	}
+}
+
+/* enables or disables the groups of the worker threads */
+static void switchWorkers(const phaseCounters *pc, unsigned long request){
+	int w;
+	for(w = 0; w < pc->numWorkers; w++){
+		if(pc->workerFd[w][0] >= 0){
+			ioctl(pc->workerFd[w][0], request, PERF_IOC_FLAG_GROUP);
+		}
+	}
+}
+
+/* adds the values of the group fd to values. The group returns the values of its open counters
+ * in the order they were opened, they are scaled in case the kernel had to multiplex the counters */
+static void readGroup(const int *fd, double *values){
+	int c, n;
+	/* group read format: nr, time_enabled, time_running, values[nr] */
+	uint64_t buffer[3 + NUM_COUNTERS];
+	double v;
+
+	if(fd[0] < 0 || read(fd[0], buffer, sizeof(buffer)) <= 0){
+		return;
+	}
+	n = 0;
+	for(c = 0; c < NUM_COUNTERS; c++){
+		if(fd[c] >= 0 && n < (int)buffer[0]){
+			v = (double)buffer[3+n];
+			if(buffer[2] > 0 && buffer[2] < buffer[1]){
+				v *= (double)buffer[1]/(double)buffer[2];
+			}
+			values[c] += v;
+			n++;
+		}
+	}
+}
+#endif
+
+static double elapsed(const struct timespec *start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - start->tv_sec) + 1e-9*(double)(now.tv_nsec - start->tv_nsec);
+}
+
+void initPhaseCounters(phaseCounters *pc, int useCounters){
+	int p, c;
+
+	memset(pc, 0, sizeof(phaseCounters));
+	for(p = 0; p < NUM_PHASES; p++){
+		for(c = 0; c < NUM_COUNTERS; c++){
+			pc->fd[p][c] = -1;
+		}
+	}
+	if(!useCounters){
+		return;
+	}
+
+#ifdef __linux__
+	/* The counters that the first group can open are used for all phases. The later groups
+	 * never open more; a counter one of them fails to open is left out of that group only
+	 * (fd[p][c] stays -1) and is reported as 0 for that phase. */
+	for(c = 0; c < NUM_COUNTERS; c++){
+		pc->available[c] = 1;
+	}
+	for(p = 0; p < NUM_PHASES; p++){
+		openGroup(pc->fd[p], pc->available);
+		if(pc->fd[p][0] < 0){
+			printf("Hardware counters are not available (perf_event_open failed), only timing the phases\n");
+			closePhaseCounters(pc);
+			return;
+		}
+		if(p == 0){
+			for(c = 1; c < NUM_COUNTERS; c++){
+				pc->available[c] = (pc->fd[0][c] >= 0);
+			}
+		}
+	}
+#ifdef _OPENMP
+	/* Every worker thread opens its own group for the output phase. The pool threads of the
+	 * runtime are reused by the later parallel regions, and all worker groups are switched
+	 * together, so it does not matter which thread a piece is written on. */
+	pc->numWorkers = omp_get_max_threads() - 1;
+	if(pc->numWorkers > 0){
+		pc->workerFd = malloc((size_t)pc->numWorkers*sizeof(*pc->workerFd));
+		if(pc->workerFd == NULL){
+			pc->numWorkers = 0;
+		}
+	}
+	if(pc->numWorkers > 0){
+		#pragma omp parallel num_threads(pc->numWorkers+1)
+		{
+			int w = omp_get_thread_num() - 1;
+			if(w >= 0 && w < pc->numWorkers){
+				openGroup(pc->workerFd[w], pc->available);
+			}
+		}
+	}
+#endif
+	pc->useCounters = 1;
+#else
+	printf("Hardware counters are only supported on Linux, only timing the phases\n");
+#endif
+}
+
+void startPhase(phaseCounters *pc, int phase){
+#ifdef __linux__
+	if(pc->useCounters){
+		ioctl(pc->fd[phase][0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		if(phase == PHASE_OUTPUT){
+			switchWorkers(pc, PERF_EVENT_IOC_ENABLE);
+		}
+	}
+#endif
+	clock_gettime(CLOCK_MONOTONIC, &pc->start);
+}
+
+void stopPhase(phaseCounters *pc, int phase){
+	pc->seconds[phase] += elapsed(&pc->start);
+	pc->calls[phase]++;
+#ifdef __linux__
+	if(pc->useCounters){
+		ioctl(pc->fd[phase][0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		if(phase == PHASE_OUTPUT){
+			switchWorkers(pc, PERF_EVENT_IOC_DISABLE);
+		}
+	}
+#endif
+}
+
+void reportPhaseCounters(const phaseCounters *pc, double numCells){
+	int p, c;
+	double total = 0.0;
+#ifdef __linux__
+	int w;
+	double values[NUM_COUNTERS];
+#endif
+
+	for(p = 0; p < NUM_PHASES; p++){
+		total += pc->seconds[p];
+	}
+	printf("\nPhase         calls    time [s]   share    MLUPS\n");
+	for(p = 0; p < NUM_PHASES; p++){
+		printf("%-12s %6i %11.4f %6.1f%% %8.2f\n", phaseNames[p], pc->calls[p], pc->seconds[p],
+				total > 0.0 ? 100.0*pc->seconds[p]/total : 0.0,
+				pc->seconds[p] > 0.0 ? 1e-6*numCells*pc->calls[p]/pc->seconds[p] : 0.0);
+	}
+	if(!pc->useCounters){
+		return;
+	}
+
+#ifdef __linux__
+	printf("\nPhase            cycles  instructions    IPC   LLC refs  LLC misses  miss rate  est. GB/s\n");
+	for(p = 0; p < NUM_PHASES; p++){
+		memset(values, 0, sizeof(values));
+		readGroup(pc->fd[p], values);
+		if(p == PHASE_OUTPUT){
+			for(w = 0; w < pc->numWorkers; w++){
+				readGroup(pc->workerFd[w], values);
+			}
+		}
+		printf("%-12s %10.3e %13.3e %6.2f %10.3e  %10.3e  %8.1f%%  %9.2f\n", phaseNames[p], values[0], values[1],
+				values[0] > 0.0 ? values[1]/values[0] : 0.0, values[2], values[3],
+				values[2] > 0.0 ? 100.0*values[3]/values[2] : 0.0,
+				pc->seconds[p] > 0.0 ? 1e-9*CACHE_LINE_BYTES*values[3]/pc->seconds[p] : 0.0);
+	}
+	for(c = 1; c < NUM_COUNTERS; c++){
+		if(!pc->available[c]){
+			printf("(%s are not supported on this machine and reported as 0)\n", counterNames[c]);
+		}
+	}
+	if(pc->numWorkers > 0){
+		printf("(the output phase counts the main thread and %i OpenMP worker threads)\n", pc->numWorkers);
+	}
+#endif
+}
+
+void closePhaseCounters(phaseCounters *pc){
+	int p, c;
+	for(p = 0; p < NUM_PHASES; p++){
+		for(c = NUM_COUNTERS-1; c >= 0; c--){
+			if(pc->fd[p][c] >= 0){
+				close(pc->fd[p][c]);
+				pc->fd[p][c] = -1;
+			}
+		}
+	}
+	for(p = 0; p < pc->numWorkers; p++){
+		for(c = NUM_COUNTERS-1; c >= 0; c--){
+			if(pc->workerFd[p][c] >= 0){
+				close(pc->workerFd[p][c]);
+			}
+		}
+	}
+	free(pc->workerFd);
+	pc->workerFd = NULL;
+	pc->numWorkers = 0;
+	pc->useCounters = 0;
+}
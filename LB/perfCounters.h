@@ -0,0 +1,47 @@
+#ifndef _PERFCOUNTERS_H_
+#define _PERFCOUNTERS_H_
+
+#include <time.h>
+
+/* phases of one LB timestep */
+#define PHASE_STREAMING 0
+#define PHASE_COLLISION 1
+#define PHASE_BOUNDARY 2
+#define PHASE_OUTPUT 3
+#define NUM_PHASES 4
+
+/* hardware counters of every phase group: cycles, instructions, LLC references, LLC misses */
+#define NUM_COUNTERS 4
+
+/** wall time and (optional) hardware counters of the phases. Each phase has its own counter group,
+ *  which only counts while the phase runs. A counter only counts the thread that opened it, so the
+ *  output phase, which writes the vti pieces on all OpenMP threads, also has one group per worker thread. */
+typedef struct {
+	int useCounters;                        /* counters were requested and could be opened */
+	int fd[NUM_PHASES][NUM_COUNTERS];       /* perf event file descriptors, fd[p][0] is the group leader */
+	int available[NUM_COUNTERS];            /* counter is supported by the (virtual) machine */
+	int numWorkers;                         /* OpenMP threads besides the main thread */
+	int (*workerFd)[NUM_COUNTERS];          /* output phase groups of the worker threads */
+	double seconds[NUM_PHASES];             /* accumulated wall time of the phases */
+	int calls[NUM_PHASES];                  /* number of times the phases ran */
+	struct timespec start;                  /* start of the running phase */
+} phaseCounters;
+
+/** starts the phase timers and, if useCounters is set, opens the hardware counters through
+ *  perf_event_open. If the counters are not available (e.g. in a VM) only the timers are used. */
+void initPhaseCounters(phaseCounters *pc, int useCounters);
+
+/** starts timing and counting of one phase */
+void startPhase(phaseCounters *pc, int phase);
+
+/** stops timing and counting of one phase */
+void stopPhase(phaseCounters *pc, int phase);
+
+/** prints the time and the counters of every phase together with derived metrics
+ *  (instructions per cycle, LLC miss rate and the memory bandwidth estimated from the LLC misses) */
+void reportPhaseCounters(const phaseCounters *pc, double numCells);
+
+/** closes the counters */
+void closePhaseCounters(phaseCounters *pc);
+
+#endif
@@ -14,6 +14,11 @@ void doStreaming(double *collideField, double *streamField,int *flagField,int xl
 	for (z = 1; z < xlength+1; z++ ) {
 		for (y = 1; y < xlength+1; y++) {
 			for (x = 1; x < xlength+1; x++) {
+                /* Obstacle cells inside the cavity are not streamed, their distributions
+                 * pointing into the fluid are set by the boundary links */
+				if(flagField[z*(xlength+2)*(xlength+2) + y * (xlength+2) + x] != FLUID){
+					continue;
+				}
                 /* Compute the index for the current cell */
 				currentCell = Q*(z*(xlength+2)*(xlength+2) + y * (xlength+2) + x );
 				for (i = 0; i < Q; i++) {
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include "visualLB.h"
 #include "LBDefinitions.h"
 #include "helper.h"
@@ -39,7 +41,7 @@ void writeVtkOutput(const double * const collideField,
 	for(z = 0; z < xlength+2; z++) {
 		for(y = 0; y < xlength+2; y++) {
 			for(x = 0; x < xlength+2; x++) {
-				if(x!=0 && x!=xlength+1 && y!=0 && y!=xlength+1 && z!=0 && z!=xlength+1){
+				if(flagField[z*(xlength+2)*(xlength+2) + y * (xlength+2) + x] == FLUID){
 					/* Get the index for current cell */
 					counter  = Q*(z*(xlength+2)*(xlength+2) + y * (xlength+2) + x );
 					/* Compute the velocity of the current cell */
@@ -65,7 +67,7 @@ void writeVtkOutput(const double * const collideField,
 	for(z = 0; z < xlength+2; z++) {
 		for(y = 0; y < xlength+2; y++) {
 			for(x = 0; x < xlength+2; x++) {
-				if(x!=0 && x!=xlength+1 && y!=0 && y!=xlength+1 && z!=0 && z!=xlength+1){
+				if(flagField[z*(xlength+2)*(xlength+2) + y * (xlength+2) + x] == FLUID){
 					/* Get the index for current cell */
 					counter  = Q*(z*(xlength+2)*(xlength+2) + y * (xlength+2) + x );
 					/* Compute the density of the current cell */
@@ -126,3 +128,305 @@ void write_vtkHeader( FILE *fp, int xlength, int ylength, int zlength ) {
 }
 
 
+
+/* returns the byte order string for the XML VTK files */
+static const char *byteOrder(void){
+	const uint16_t one = 1;
+	return (*(const unsigned char *)&one == 1) ? "LittleEndian" : "BigEndian";
+}
+
+/* writes one block of the appended data section: the size of the block followed by the raw data */
+static void writeAppendedBlock(FILE *fp, const void *data, uint64_t bytes){
+	fwrite(&bytes, sizeof(uint64_t), 1, fp);
+	fwrite(data, 1, (size_t)bytes, fp);
+}
+
+/* computes the moments of the points z0..z1 and writes them to one .vti piece file.
+ * Returns 0 on success. */
+static int writeVtiPiece(const double * const collideField,
+		const int * const flagField,
+		const char *szFileName,
+		int xlength, int z0, int z1){
+	int x, y, z;
+	int counter;
+	double density;
+	double cellVelocity[3];
+	uint64_t numPoints = (uint64_t)(xlength+2)*(xlength+2)*(z1-z0+1);
+	uint64_t n = 0;
+	float *velocity = (float *) malloc((size_t)(3*numPoints*sizeof(float)));
+	double *densities = (double *) malloc((size_t)(numPoints*sizeof(double)));
+	int *flags = (int *) malloc((size_t)(numPoints*sizeof(int)));
+	FILE *fp = NULL;
+
+	if(velocity == NULL || densities == NULL || flags == NULL){
+		free(velocity);
+		free(densities);
+		free(flags);
+		return 1;
+	}
+
+	/* Evaluate the piece in memory first, so the file is written with a few large writes */
+	for(z = z0; z <= z1; z++) {
+		for(y = 0; y < xlength+2; y++) {
+			for(x = 0; x < xlength+2; x++) {
+				counter = z*(xlength+2)*(xlength+2) + y * (xlength+2) + x;
+				if(flagField[counter] == FLUID){
+					computeDensity (&collideField[Q*counter], &density) ;
+					computeVelocity(&collideField[Q*counter], &density, cellVelocity) ;
+					velocity[3*n]   = (float)cellVelocity[0];
+					velocity[3*n+1] = (float)cellVelocity[1];
+					velocity[3*n+2] = (float)cellVelocity[2];
+					densities[n] = density;
+				}
+				else{
+					velocity[3*n] = velocity[3*n+1] = velocity[3*n+2] = 0.0f;
+					densities[n] = 0.0;
+				}
+				flags[n] = flagField[counter];
+				n++;
+			}
+		}
+	}
+
+	fp = fopen(szFileName, "wb");
+	if(fp != NULL){
+		fprintf(fp, "<?xml version=\"1.0\"?>\n");
+		fprintf(fp, "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n", byteOrder());
+		fprintf(fp, "<ImageData WholeExtent=\"0 %i 0 %i 0 %i\" Origin=\"0 0 0\" Spacing=\"1 1 1\">\n",
+				xlength+1, xlength+1, xlength+1);
+		fprintf(fp, "<Piece Extent=\"0 %i 0 %i %i %i\">\n", xlength+1, xlength+1, z0, z1);
+		fprintf(fp, "<PointData Vectors=\"velocity\" Scalars=\"density\">\n");
+		fprintf(fp, "<DataArray type=\"Float32\" Name=\"velocity\" NumberOfComponents=\"3\" format=\"appended\" offset=\"0\"/>\n");
+		fprintf(fp, "<DataArray type=\"Float64\" Name=\"density\" format=\"appended\" offset=\"%lu\"/>\n",
+				(unsigned long)(sizeof(uint64_t) + 3*numPoints*sizeof(float)));
+		fprintf(fp, "<DataArray type=\"Int32\" Name=\"flagfield\" format=\"appended\" offset=\"%lu\"/>\n",
+				(unsigned long)(2*sizeof(uint64_t) + 3*numPoints*sizeof(float) + numPoints*sizeof(double)));
+		fprintf(fp, "</PointData>\n</Piece>\n</ImageData>\n");
+		fprintf(fp, "<AppendedData encoding=\"raw\">\n_");
+		writeAppendedBlock(fp, velocity, 3*numPoints*sizeof(float));
+		writeAppendedBlock(fp, densities, numPoints*sizeof(double));
+		writeAppendedBlock(fp, flags, numPoints*sizeof(int));
+		fprintf(fp, "\n</AppendedData>\n</VTKFile>\n");
+	}
+
+	free(velocity);
+	free(densities);
+	free(flags);
+	if(fp == NULL){
+		return 1;
+	}
+	return fclose(fp) != 0;
+}
+
+/** writes the density, velocity and flag field as a parallel VTK image. The pieces share their
+ *  boundary plane in z, so the dataset is closed when the pieces are assembled.
+ */
+void writeVtiOutput(const double * const collideField,
+		const int * const flagField,
+		const char *filename,
+		unsigned int t, int xlength, int numPieces){
+	int p;
+	int failed = 0;
+	char szFileName[200];
+	const char *baseName;
+	FILE *fp=NULL;
+
+	/* There are xlength+1 point intervals in z, each piece needs at least one */
+	if(numPieces > xlength+1){
+		numPieces = xlength+1;
+	}
+
+	/* Every thread evaluates and writes its own pieces concurrently */
+	#pragma omp parallel for schedule(dynamic,1) reduction(+:failed)
+	for(p = 0; p < numPieces; p++){
+		char szPieceName[200];
+		int z0 = p*(xlength+1)/numPieces;
+		int z1 = (p+1)*(xlength+1)/numPieces;
+		sprintf(szPieceName, "%s.%i.%i.vti", filename, t, p);
+		failed += writeVtiPiece(collideField, flagField, szPieceName, xlength, z0, z1);
+	}
+	if(failed){
+		char szBuff[80];
+		sprintf( szBuff, "Failed to write %i vti pieces", failed );
+		ERROR( szBuff );
+		return;
+	}
+
+	/* The pieces are referenced relative to the .pvti file, which lies in the same directory */
+	baseName = strrchr(filename, '/');
+	baseName = (baseName == NULL) ? filename : baseName+1;
+
+	sprintf( szFileName, "%s.%i.pvti", filename, t );
+	fp = fopen( szFileName, "w");
+	if( fp == NULL )
+	{
+		ERROR( "Failed to open pvti file" );
+		return;
+	}
+	fprintf(fp, "<?xml version=\"1.0\"?>\n");
+	fprintf(fp, "<VTKFile type=\"PImageData\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n", byteOrder());
+	fprintf(fp, "<PImageData WholeExtent=\"0 %i 0 %i 0 %i\" GhostLevel=\"0\" Origin=\"0 0 0\" Spacing=\"1 1 1\">\n",
+			xlength+1, xlength+1, xlength+1);
+	fprintf(fp, "<PPointData Vectors=\"velocity\" Scalars=\"density\">\n");
+	fprintf(fp, "<PDataArray type=\"Float32\" Name=\"velocity\" NumberOfComponents=\"3\"/>\n");
+	fprintf(fp, "<PDataArray type=\"Float64\" Name=\"density\"/>\n");
+	fprintf(fp, "<PDataArray type=\"Int32\" Name=\"flagfield\"/>\n");
+	fprintf(fp, "</PPointData>\n");
+	for(p = 0; p < numPieces; p++){
+		fprintf(fp, "<Piece Extent=\"0 %i 0 %i %i %i\" Source=\"%s.%i.%i.vti\"/>\n", xlength+1, xlength+1,
+				p*(xlength+1)/numPieces, (p+1)*(xlength+1)/numPieces, baseName, t, p);
+	}
+	fprintf(fp, "</PImageData>\n</VTKFile>\n");
+
+	if( fclose(fp) )
+	{
+		ERROR( "Failed to close pvti file" );
+	}
+}
+
+/** reads the output regions from the config file and checks that they lie inside the lattice. */
+int readOutputRegions(const char *filename, outputRegion **regions, int xlength){
+	int numRegions;
+	int k, d;
+	char szName[40];
+	char szBuff[80];
+	outputRegion *region;
+
+	read_int(filename, "outputRegions", &numRegions);
+	*regions = NULL;
+	if(numRegions <= 0){
+		return 0;
+	}
+
+	*regions = (outputRegion *) malloc((size_t)(numRegions * sizeof(outputRegion)));
+	if(*regions == NULL){
+		ERROR("Storage cannot be allocated");
+	}
+
+	for(k = 0; k < numRegions; k++){
+		region = &(*regions)[k];
+		sprintf(szName, "region%i", k);
+		/* find_string stops the program if the region is not defined */
+		if(sscanf(find_string(filename, szName), "%d %d %d %d %d %d %d %d",
+				&region->min[0], &region->max[0], &region->min[1], &region->max[1],
+				&region->min[2], &region->max[2], &region->stride, &region->interval) != 8){
+			sprintf(szBuff, "Wrong format of %s in %s", szName, filename);
+			ERROR(szBuff);
+		}
+		/* Check that the region lies inside the lattice including the boundary layer */
+		for(d = 0; d < 3; d++){
+			if(region->min[d] < 0 || region->max[d] > xlength+1 || region->min[d] > region->max[d]){
+				sprintf(szBuff, "%s exceeds the lattice", szName);
+				ERROR(szBuff);
+			}
+		}
+		if(region->stride < 1 || region->interval < 1){
+			sprintf(szBuff, "%s needs stride and interval >= 1", szName);
+			ERROR(szBuff);
+		}
+		printf("Output region %i: [%i,%i]x[%i,%i]x[%i,%i], stride %i, every %i timesteps\n", k,
+				region->min[0], region->max[0], region->min[1], region->max[1],
+				region->min[2], region->max[2], region->stride, region->interval);
+	}
+	return numRegions;
+}
+
+/** writes the density and velocity field of the cells inside 'region'. The moments are only
+ *  computed for the sampled cells, obstacle and boundary cells are written as zero like in writeVtkOutput.
+ */
+void writeVtkRegion(const double * const collideField,
+		const int * const flagField,
+		const char *filename,
+		unsigned int t, int xlength,
+		const outputRegion *region, int regionNumber){
+	int x, y, z;
+	int d;
+	int dims[3];
+	char szFileName[200];
+	FILE *fp=NULL;
+	int counter;
+	double density;
+	double velocity[3];
+
+	/* Number of sampled cells in each direction */
+	for(d = 0; d < 3; d++){
+		dims[d] = (region->max[d]-region->min[d])/region->stride + 1;
+	}
+
+	sprintf( szFileName, "%s.region%i.%i.vtk", filename, regionNumber, t );
+	fp = fopen( szFileName, "w");
+	if( fp == NULL )
+	{
+		char szBuff[80];
+		sprintf( szBuff, "Failed to open region file %i", regionNumber );
+		ERROR( szBuff );
+		return;
+	}
+
+	/* The region is a structured points dataset placed at its first cell */
+	fprintf(fp,"# vtk DataFile Version 2.0\n");
+	fprintf(fp,"generated for CFD-lab course output (Based in code by Tobias Neckel) \n");
+	fprintf(fp,"ASCII\n");
+	fprintf(fp,"\n");
+	fprintf(fp,"DATASET STRUCTURED_POINTS\n");
+	fprintf(fp,"DIMENSIONS  %i %i %i \n", dims[0], dims[1], dims[2]);
+	fprintf(fp,"ORIGIN %i %i %i\n", region->min[0], region->min[1], region->min[2]);
+	fprintf(fp,"SPACING %i %i %i\n", region->stride, region->stride, region->stride);
+	fprintf(fp,"\n");
+
+	/* Write the velocity vectors of the sampled cells */
+	fprintf(fp,"\nPOINT_DATA %i \n", dims[0]*dims[1]*dims[2] );
+	fprintf(fp, "VECTORS velocity float\n");
+	for(z = region->min[2]; z <= region->max[2]; z += region->stride) {
+		for(y = region->min[1]; y <= region->max[1]; y += region->stride) {
+			for(x = region->min[0]; x <= region->max[0]; x += region->stride) {
+				if(flagField[z*(xlength+2)*(xlength+2) + y * (xlength+2) + x] == FLUID){
+					counter  = Q*(z*(xlength+2)*(xlength+2) + y * (xlength+2) + x );
+					computeDensity (&collideField[counter] , &density) ;
+					computeVelocity(&collideField[counter], &density,velocity) ;
+					fprintf(fp, "%f %f %f\n", velocity[0], velocity[1] , velocity[2]);
+				}
+				else{
+					fprintf(fp, "0 0 0\n");
+				}
+			}
+		}
+	}
+
+	fprintf(fp,"\n");
+	fprintf(fp, "SCALARS density double 1\n");
+	fprintf(fp, "LOOKUP_TABLE default\n");
+	for(z = region->min[2]; z <= region->max[2]; z += region->stride) {
+		for(y = region->min[1]; y <= region->max[1]; y += region->stride) {
+			for(x = region->min[0]; x <= region->max[0]; x += region->stride) {
+				if(flagField[z*(xlength+2)*(xlength+2) + y * (xlength+2) + x] == FLUID){
+					counter  = Q*(z*(xlength+2)*(xlength+2) + y * (xlength+2) + x );
+					computeDensity (&collideField[counter] , &density) ;
+					fprintf(fp, "%f\n", density);
+				}
+				else{
+					fprintf(fp, "0\n");
+				}
+			}
+		}
+	}
+
+	fprintf(fp,"\n");
+	fprintf(fp, "SCALARS flagfield int 1\n");
+	fprintf(fp, "LOOKUP_TABLE default\n");
+	for(z = region->min[2]; z <= region->max[2]; z += region->stride) {
+		for(y = region->min[1]; y <= region->max[1]; y += region->stride) {
+			for(x = region->min[0]; x <= region->max[0]; x += region->stride) {
+				counter  = ((z * (xlength+2) * (xlength+2) + y * (xlength+2) + x));
+				fprintf(fp, "%i\n", flagField[counter]);
+			}
+		}
+	}
+
+	if( fclose(fp) )
+	{
+		char szBuff[80];
+		sprintf( szBuff, "Failed to close region file %i", regionNumber );
+		ERROR( szBuff );
+	}
+}
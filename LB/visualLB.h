@@ -12,6 +12,39 @@ void writeVtkOutput(const double * const collideField,
 /* auxiliary function to write the header and the geometry for the vtk file.*/
 void write_vtkHeader( FILE *fp, int xlength, int ylength, int zlength);
 
+/** writes the density, velocity and flag field as a parallel VTK image (.pvti). The lattice is
+ *  split along z into 'numPieces' pieces. Every piece is evaluated and written to its own binary
+ *  .vti file by one thread, the .pvti file only references the pieces. */
+void writeVtiOutput(const double * const collideField,
+		const int * const flagField,
+		const char *filename,
+		unsigned int t, int xlength, int numPieces);
+
+/** axis-aligned output region of the lattice. The region covers the cells min..max
+ *  (inclusive) in each direction, so a slice is a region with min == max along one axis.
+ *  Only every 'stride'-th cell is written and the region is written every 'interval' timesteps.
+ */
+typedef struct {
+	int min[3];
+	int max[3];
+	int stride;
+	int interval;
+} outputRegion;
+
+/** reads the output regions from the config file. The number of regions is given by the
+ *  parameter "outputRegions", region k is described by the line
+ *  "regionk xmin xmax ymin ymax zmin zmax stride interval". Returns the number of regions.
+ */
+int readOutputRegions(const char *filename, outputRegion **regions, int xlength);
+
+/** writes the density and velocity field of the cells inside 'region' to a file determined by
+ *  'filename', the region number and timestep 't'. Only the cells of the region are evaluated. */
+void writeVtkRegion(const double * const collideField,
+		const int * const flagField,
+		const char *filename,
+		unsigned int t, int xlength,
+		const outputRegion *region, int regionNumber);
+
 
 #endif
 
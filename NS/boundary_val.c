@@ -5,6 +5,192 @@
 /*                             Set Boundary Conditions                     */
 /* ----------------------------------------------------------------------- */
 
+/*
+ * Handlers of the outer walls, one for each wall and boundary type. boundary_init() picks the
+ * four handlers of the scenario once, so boundaryvalues() does not switch on the wall types
+ * in every time step.
+ */
+static void left_no_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int j;
+	for (j = 1; j < jmax + 1; j++){
+		/*U velocity on left boundary */
+		u[j] = 0;
+		/*V velocity left boundary */
+		v[j] = -1*v[ld+j];
+	}
+}
+
+static void left_free_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int j;
+	for (j = 1; j < jmax + 1; j++){
+		u[j] = 0;
+		v[j] = v[ld+j];
+	}
+}
+
+static void left_outflow(int imax, int jmax, int ld, double *u, double *v)
+{
+	int j;
+	for (j = 1; j < jmax + 1; j++){
+		u[j] = u[ld+j];
+		v[j] = v[ld+j];
+	}
+}
+
+static void right_no_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int j;
+	for (j = 1; j < jmax + 1; j++){
+		u[mat_idx(imax, j, ld)] = 0;
+		v[mat_idx(imax+1, j, ld)] = -1*v[mat_idx(imax, j, ld)];
+	}
+}
+
+static void right_free_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int j;
+	for (j = 1; j < jmax + 1; j++){
+		u[mat_idx(imax, j, ld)] = 0;
+		v[mat_idx(imax+1, j, ld)] = v[mat_idx(imax, j, ld)];
+	}
+}
+
+static void right_outflow(int imax, int jmax, int ld, double *u, double *v)
+{
+	int j;
+	for (j = 1; j < jmax + 1; j++){
+		u[mat_idx(imax, j, ld)] = u[mat_idx(imax-1, j, ld)];
+		v[mat_idx(imax+1, j, ld)] = v[mat_idx(imax, j, ld)];
+	}
+}
+
+static void top_no_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int i;
+	for (i = 1; i < imax + 1; i++){
+		v[mat_idx(i, jmax, ld)] = 0;
+		u[mat_idx(i, jmax+1, ld)] = -1*u[mat_idx(i, jmax, ld)];
+	}
+}
+
+static void top_free_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int i;
+	for (i = 1; i < imax + 1; i++){
+		v[mat_idx(i, jmax, ld)] = 0;
+		u[mat_idx(i, jmax+1, ld)] = u[mat_idx(i, jmax, ld)];
+	}
+}
+
+static void top_outflow(int imax, int jmax, int ld, double *u, double *v)
+{
+	int i;
+	for (i = 1; i < imax + 1; i++){
+		v[mat_idx(i, jmax, ld)] = v[mat_idx(i, jmax-1, ld)];
+		u[mat_idx(i, jmax+1, ld)] = u[mat_idx(i, jmax, ld)];
+	}
+}
+
+static void bottom_no_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int i;
+	for (i = 1; i < imax + 1; i++){
+		v[mat_idx(i, 0, ld)] = 0;
+		u[mat_idx(i, 0, ld)] = -1*u[mat_idx(i, 1, ld)];
+	}
+}
+
+static void bottom_free_slip(int imax, int jmax, int ld, double *u, double *v)
+{
+	int i;
+	for (i = 1; i < imax + 1; i++){
+		v[mat_idx(i, 0, ld)] = 0;
+		u[mat_idx(i, 0, ld)] = u[mat_idx(i, 1, ld)];
+	}
+}
+
+static void bottom_outflow(int imax, int jmax, int ld, double *u, double *v)
+{
+	int i;
+	for (i = 1; i < imax + 1; i++){
+		v[mat_idx(i, 0, ld)] = v[mat_idx(i, 1, ld)];
+		u[mat_idx(i, 0, ld)] = u[mat_idx(i, 1, ld)];
+	}
+}
+
+/* walls of an unknown boundary type keep their values */
+static void wall_unset(int imax, int jmax, int ld, double *u, double *v)
+{
+}
+
+/* handlers of the walls WALL_LEFT ... WALL_BOTTOM, indexed by NO_SLIP-1 ... OUTFLOW-1 */
+static const wall_handler wall_handlers[WALLS][3] = {
+	{left_no_slip, left_free_slip, left_outflow},
+	{right_no_slip, right_free_slip, right_outflow},
+	{top_no_slip, top_free_slip, top_outflow},
+	{bottom_no_slip, bottom_free_slip, bottom_outflow}
+};
+
+void boundary_init(
+		boundary_set *bc,
+		const char *problem,
+		int imax,
+		int jmax,
+		const int wl,
+		const int wr,
+		const int wt,
+		const int wb
+) {
+	const int type[WALLS] = {wl, wr, wt, wb};
+	int w, i, j;
+
+	for(w = 0; w < WALLS; w++){
+		if(type[w] >= NO_SLIP && type[w] <= OUTFLOW){
+			bc->wall[w] = wall_handlers[w][type[w]-NO_SLIP];
+		}
+		else{
+			bc->wall[w] = wall_unset;
+		}
+	}
+
+	/* velocity profiles of the special boundary conditions, see spec_boundary_val() */
+	bc->inflow = NULL;
+	bc->lid = NULL;
+	if(strcmp(problem,"cavity")==0){
+		/* the lid moves with velocity 1 */
+		bc->lid = (double*)malloc((size_t)(imax+1)*sizeof(double));
+		if(bc->lid == NULL){
+			ERROR("Storage cannot be allocated");
+		}
+		for (i = 1; i < imax + 1; i++){
+			bc->lid[i] = 1.0;
+		}
+	}
+	else if(strcmp(problem,"KarmanVortexStreet")==0 || strcmp(problem,"FlowOverStep")==0){
+		bc->inflow = (double*)malloc((size_t)(jmax+1)*sizeof(double));
+		if(bc->inflow == NULL){
+			ERROR("Storage cannot be allocated");
+		}
+		for (j = 1; j < jmax + 1; j++){
+			bc->inflow[j] = 1.0;
+		}
+		/* the step covers the lower half of the inflow */
+		if(strcmp(problem,"FlowOverStep")==0){
+			for (j = 1; j <= (jmax)/2; j++){
+				bc->inflow[j] = 0.0;
+			}
+		}
+	}
+}
+
+void boundary_free(boundary_set *bc)
+{
+	free(bc->inflow);
+	free(bc->lid);
+}
+
 /**
  * The boundary values of the problem are set.
  */
@@ -13,14 +199,14 @@ void boundaryvalues(
 		int jmax,
 		double **U,
 		double **V,
-		const int wl,
-		const int wr,
-		const int wt,
-		const int wb,
-		int **Flag
+		const boundary_set *bc,
+		const cell_lists *cells
 ) {
 
-	int i,j;
+	int w,k,c;
+	const int ld = MATRIX_LD(U);
+	double *u = U[0];
+	double *v = V[0];
 	/*Initialize corners*/
 	U[0][0]=0.0;
 	U[0][jmax+1]=0.0;
@@ -31,203 +217,99 @@ void boundaryvalues(
 	V[imax+1][0]=0.0;
 	V[imax+1][jmax+1]=0.0;
 
-	/* Set values for all the outside boundary depending on the value that
-	 * the data file is set to. NO_SLIP = 1, FREE_SLIP=2 and OUTFLOW=3
-	 * We start with the left boundary. */
-	switch(wl){
-	case NO_SLIP:
-		for (j = 1; j < jmax + 1; j++){
-			/*U velocity on left boundary */
-			U[0][j] = 0;
-			/*V velocity left boundary */
-			V[0][j]=-1*V[1][j];
-		}
-		break;
-	case FREE_SLIP:
-		for (j = 1; j < jmax + 1; j++){
-			/*U velocity on left boundary */
-			U[0][j] = 0;
-			/*V velocity left boundary */
-			V[0][j] = V[1][j];
-		}
-		break;
-	case OUTFLOW:
-		for (j = 1; j < jmax + 1; j++){
-			/*U velocity on left boundary */
-			U[0][j] = U[1][j];
-			/*V velocity left boundary */
-			V[0][j]= V[1][j];
-		}
-		break;
-	default:
-		break;
+	/* Set values for all the outside boundary with the handlers of the wall types
+	 * (NO_SLIP = 1, FREE_SLIP=2 and OUTFLOW=3): left, right, top and bottom */
+	for(w = 0; w < WALLS; w++){
+		bc->wall[w](imax, jmax, ld, u, v);
 	}
 
-	/*Set values for the right boundary*/
-	switch(wr){
-	case NO_SLIP:
-		for (j = 1; j < jmax + 1; j++){
-			U[imax][j] = 0;
-			V[imax+1][j]=-1*V[imax][j];
-		}
-		break;
-	case FREE_SLIP:
-		for (j = 1; j < jmax + 1; j++){
-			U[imax][j] = 0;
-			V[imax+1][j] = V[imax][j];
-		}
-		break;
-	case OUTFLOW:
-		for (j = 1; j < jmax + 1; j++){
-			U[imax][j] = U[imax-1][j];
-			V[imax+1][j]= V[imax][j];
-		}
-		break;
-	default:
-		break;
+	/**
+	 * Boundary cells in the inner domain: every type has its own list, so each loop
+	 * assigns the values of U and V for one configuration without testing the flags.
+	 */
+	for(k = 0; k < cells->nbnd[CELL_N]; k++){
+		c = cells->bnd[CELL_N][k];
+		v[c]=0;
+		u[c-ld]=-1*u[c-ld+1];
+		u[c]=-1*u[c+1];
 	}
-
-	/*Set values for the top boundary*/
-	switch(wt){
-	case NO_SLIP:
-		for (i = 1; i < imax + 1; i++){
-			V[i][jmax] = 0;
-			U[i][jmax+1]= -1*U[i][jmax];
-		}
-		break;
-	case FREE_SLIP:
-		for (i = 1; i < imax + 1; i++){
-			V[i][jmax] = 0;
-			U[i][jmax+1] = U[i][jmax];
-		}
-		break;
-	case OUTFLOW:
-		for (i = 1; i < imax + 1; i++){
-			V[i][jmax] = V[i][jmax-1];
-			U[i][jmax+1] = U[i][jmax];
-		}
-		break;
-	default:
-		break;
+	for(k = 0; k < cells->nbnd[CELL_S]; k++){
+		c = cells->bnd[CELL_S][k];
+		v[c-1]=0;
+		u[c-ld]=-1*u[c-ld-1];
+		u[c]=-1*u[c-1];
 	}
-
-	/*Set values for the bottom boundary*/
-	switch(wb){
-	case NO_SLIP:
-		for (i = 1; i < imax + 1; i++){
-			V[i][0] = 0;
-			U[i][0]=-1*U[i][1];
-		}
-		break;
-	case FREE_SLIP:
-		for (i = 1; i < imax + 1; i++){
-			V[i][0] = 0;
-			U[i][0] = U[i][1];
-		}
-		break;
-	case OUTFLOW:
-		for (i = 1; i < imax + 1; i++){
-			V[i][0] = V[i][1];
-			U[i][0]= U[i][1];
-		}
-		break;
-	default:
-		break;
+	for(k = 0; k < cells->nbnd[CELL_W]; k++){
+		c = cells->bnd[CELL_W][k];
+		u[c-ld]=0;
+		v[c-1]=-1*v[c-ld-1];
+		v[c]=-1*v[c-ld];
 	}
-
-	/**
-	 * Loop to check for boundary cells in the inner domain, and assign
-	 * correct values of U and V.
-	 */
-	for(i = 1; i < imax+1; i++){
-		for(j = 1; j < jmax+1; j++){
-			if((Flag[i][j]&31)==B_N){
-				V[i][j]=0;
-				U[i-1][j]=-1*U[i-1][j+1];
-				U[i][j]=-1*U[i][j+1];
-			}
-			else if((Flag[i][j]&31)==B_S){
-				V[i][j-1]=0;
-				U[i-1][j]=-1*U[i-1][j-1];
-				U[i][j]=-1*U[i][j-1];
-			}
-			else if((Flag[i][j]&31)==B_W){
-				U[i-1][j]=0;
-				V[i][j-1]=-1*V[i-1][j-1];
-				V[i][j]=-1*V[i-1][j];
-			}
-			else if((Flag[i][j]&31)==B_O){
-				U[i][j]=0;
-				V[i][j-1]=-1*V[i+1][j-1];
-				V[i][j]=-1*V[i+1][j];
-			}
-			else if((Flag[i][j]&31)==B_NO){
-				U[i][j]=0;
-				U[i-1][j]=-1*U[i-1][j+1];
-				V[i][j]=0;
-				V[i][j-1]=-1*V[i+1][j-1];
-			}
-			else if((Flag[i][j]&31)==B_NW){
-				U[i-1][j]=0;
-				U[i][j]=-1*U[i][j+1];
-				V[i][j]=0;
-				V[i][j-1]=-1*V[i-1][j-1];
-			}
-			else if((Flag[i][j]&31)==B_SO){
-				U[i][j]=0;
-				U[i-1][j]=-1*U[i-1][j-1];
-				V[i][j-1]=0;
-				V[i][j]=-1*V[i+1][j];
-			}
-			else if((Flag[i][j]&31)==B_SW){
-				U[i-1][j]=0;
-				U[i][j]=-1*U[i][j-1];
-				V[i][j]=-1*V[i-1][j];
-				V[i][j-1]=0;
-			}
-		}
+	for(k = 0; k < cells->nbnd[CELL_O]; k++){
+		c = cells->bnd[CELL_O][k];
+		u[c]=0;
+		v[c-1]=-1*v[c+ld-1];
+		v[c]=-1*v[c+ld];
+	}
+	for(k = 0; k < cells->nbnd[CELL_NO]; k++){
+		c = cells->bnd[CELL_NO][k];
+		u[c]=0;
+		u[c-ld]=-1*u[c-ld+1];
+		v[c]=0;
+		v[c-1]=-1*v[c+ld-1];
+	}
+	for(k = 0; k < cells->nbnd[CELL_NW]; k++){
+		c = cells->bnd[CELL_NW][k];
+		u[c-ld]=0;
+		u[c]=-1*u[c+1];
+		v[c]=0;
+		v[c-1]=-1*v[c-ld-1];
+	}
+	for(k = 0; k < cells->nbnd[CELL_SO]; k++){
+		c = cells->bnd[CELL_SO][k];
+		u[c]=0;
+		u[c-ld]=-1*u[c-ld-1];
+		v[c-1]=0;
+		v[c]=-1*v[c+ld];
+	}
+	for(k = 0; k < cells->nbnd[CELL_SW]; k++){
+		c = cells->bnd[CELL_SW][k];
+		u[c-ld]=0;
+		u[c]=-1*u[c-1];
+		v[c]=-1*v[c-ld];
+		v[c-1]=0;
 	}
 
 }
 
 void spec_boundary_val(
-		char *problem,
 		int imax,
 		int jmax,
 		double **U,
-		double **V
+		double **V,
+		const boundary_set *bc
 ){
 	int i,j;
+	const int ld = MATRIX_LD(U);
+	double *u = U[0];
+	double *v = V[0];
 	/**
-	 * Special boundary condition for the cavity problem.
+	 * Special boundary condition for the cavity problem: the moving lid.
 	 */
-	if(strcmp(problem,"cavity")==0){
+	if(bc->lid != NULL){
 		for (i = 1; i < imax + 1; i++){
-			V[i][jmax] = 0;
-			U[i][jmax+1]= 2.0-1*U[i][jmax];
+			v[mat_idx(i, jmax, ld)] = 0;
+			u[mat_idx(i, jmax+1, ld)] = 2.0*bc->lid[i]-1*u[mat_idx(i, jmax, ld)];
 		}
 	}
 	/*
-	 * Special boundary condition for the Karman Vortex street
-	 * problem
+	 * Special boundary condition for the Karman Vortex street and the Flow Over
+	 * Step problem: the inflow profile on the left boundary
 	 */
-	if(strcmp(problem,"KarmanVortexStreet")==0){
+	if(bc->inflow != NULL){
 		for (j = 1; j < jmax + 1; j++){
-			U[0][j] = 1.0;
-			V[0][j]= 0.0;
-		}
-	}
-	/*
-	 * Special boundary condition for the Flow Over Step problem
-	 */
-	if(strcmp(problem,"FlowOverStep")==0){
-		for (j = 1; j <= (jmax)/2; j++){
-			U[0][j] = 0.0;
-			V[0][j]= 0.0;
-		}
-		for (j = ((jmax)/2) + 1; j < jmax + 1; j++){
-			U[0][j] = 1.0;
-			V[0][j]= 0.0;
+			u[j] = bc->inflow[j];
+			v[j] = 0.0;
 		}
 	}
 }
@@ -1,29 +1,73 @@
 #ifndef __RANDWERTE_H__
 #define __RANDWERTE_H__
 
+#include "helper.h"
+
 
 /**
- * The boundary values of the problem are set.
+ * Index of the outer walls in boundary_set
  */
-void boundaryvalues(
+enum { WALL_LEFT, WALL_RIGHT, WALL_TOP, WALL_BOTTOM, WALLS };
+
+/**
+ * Sets the values of U and V on one outer wall for one boundary type.
+ */
+typedef void (*wall_handler)(int imax, int jmax, int ld, double *u, double *v);
+
+/**
+ * The boundary conditions of a scenario, bound once by boundary_init(): the handlers of the
+ * four walls for their boundary types wl, wr, wt and wb, and the velocity profiles of the
+ * special boundary conditions of the problem (NULL if it has none): inflow[j] is U on the
+ * left boundary (Karman vortex street, flow over a step), lid[i] the velocity of the top
+ * wall (driven cavity).
+ */
+typedef struct {
+	wall_handler wall[WALLS];
+	double *inflow;
+	double *lid;
+} boundary_set;
+
+/**
+ * Selects the wall handlers for the boundary types (NO_SLIP, FREE_SLIP or OUTFLOW, other
+ * walls are left unchanged) and computes the profiles of the special boundary conditions of
+ * the problem.
+ */
+void boundary_init(
+		boundary_set *bc,
+		const char *problem,
 		int imax,
 		int jmax,
-		double **U,
-		double **V,
 		const int wl,
 		const int wr,
 		const int wt,
-		const int wb,
-		int **Flag
+		const int wb
 );
+
+/**
+ * Releases the profiles of boundary_init().
+ */
+void boundary_free(boundary_set *bc);
+
 /**
- * Function to set special boundary values.
+ * The boundary values of the problem are set. The obstacle cells are taken from the
+ * precompiled boundary cell lists.
+ */
+void boundaryvalues(
+		int imax,
+		int jmax,
+		double **U,
+		double **V,
+		const boundary_set *bc,
+		const cell_lists *cells
+);
+/**
+ * Function to set special boundary values from the profiles of boundary_init().
  */
 void spec_boundary_val(
-		char *problem,
 		int imax,
 		int jmax,
 		double **U,
-		double **V);
+		double **V,
+		const boundary_set *bc);
 
 #endif
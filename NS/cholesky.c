@@ -0,0 +1,385 @@
+#include "cholesky.h"
+#include "sor.h"
+#include "helper.h"
+#include <math.h>
+
+/* boxes with at most this many cells are not dissected any further */
+#define ND_LEAF_CELLS 16
+
+/*
+ * Numbers the fluid cells of the box [i0,i1]x[j0,j1] by nested dissection: the box is cut
+ * in the middle of its longer side, the two halves are numbered first and the separating
+ * line of cells last.
+ */
+static void nested_dissection(cholesky *ch, int i0, int i1, int j0, int j1, uint8_t **Flag, int *next)
+{
+	int i, j, m;
+
+	if(i0 > i1 || j0 > j1) {
+		return;
+	}
+	if((i1-i0+1)*(j1-j0+1) <= ND_LEAF_CELLS) {
+		for(i = i0; i <= i1; i++) {
+			for(j = j0; j <= j1; j++) {
+				if((Flag[i][j]&B_C)==B_C) {
+					ch->index[i][j] = *next;
+					ch->cell_i[*next] = i;
+					ch->cell_j[*next] = j;
+					(*next)++;
+				}
+			}
+		}
+		return;
+	}
+	if(i1-i0 >= j1-j0) {
+		m = (i0+i1)/2;
+		nested_dissection(ch, i0, m-1, j0, j1, Flag, next);
+		nested_dissection(ch, m+1, i1, j0, j1, Flag, next);
+		nested_dissection(ch, m, m, j0, j1, Flag, next);
+	}
+	else {
+		m = (j0+j1)/2;
+		nested_dissection(ch, i0, i1, j0, m-1, Flag, next);
+		nested_dissection(ch, i0, i1, m+1, j1, Flag, next);
+		nested_dissection(ch, i0, i1, m, m, Flag, next);
+	}
+}
+
+/*
+ * Nonzero pattern of row k of L: the nodes reached in the elimination tree from the nonzeros
+ * A(i,k), i < k. The pattern is returned in s[top..n-1] in topological order.
+ */
+static int ereach(int k, const int *Ap, const int *Ai, const int *parent, int *s, int *mark, int n)
+{
+	int p, i, len, top = n;
+
+	mark[k] = k;
+	for(p = Ap[k]; p < Ap[k+1]; p++) {
+		i = Ai[p];
+		if(i > k) {
+			continue;
+		}
+		for(len = 0; i != -1 && mark[i] != k; i = parent[i]) {
+			s[len++] = i;
+			mark[i] = k;
+		}
+		while(len > 0) {
+			s[--top] = s[--len];
+		}
+	}
+	return top;
+}
+
+void chol_init(
+		cholesky *ch,
+		int imax,
+		int jmax,
+		double dx,
+		double dy,
+		uint8_t **Flag
+){
+	int i, j, k, p, q, top, inext, next = 0, nnz;
+	double cx = 1.0/(dx*dx);
+	double cy = 1.0/(dy*dy);
+	double d, lki;
+	int *Ap, *Ai, *parent, *ancestor, *mark, *s, *c;
+	double *Ax;
+	int ni[8], nj[8];
+	double nc[8];
+	/* corner cell couplings, see pcg_init() */
+	double w = 0.25*(cx+cy);
+	double **cnw, **csw;
+
+	/* P_L and P_R are set for the whole left/right column, see init_flag() */
+	ch->left_dirichlet = (Flag[0][1]&P_L)==P_L;
+	ch->right_dirichlet = (Flag[imax+1][1]&P_R)==P_R;
+
+	ch->index = imatrix(0, imax+1, 0, jmax+1);
+	init_imatrix(ch->index, 0, imax+1, 0, jmax+1, -1);
+	ch->n = 0;
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if((Flag[i][j]&B_C)==B_C) {
+				ch->n++;
+			}
+		}
+	}
+	ch->cell_i = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	ch->cell_j = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	ch->x = (double *) malloc((size_t)((ch->n+1)*sizeof(double)));
+	Ap = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	Ai = (int *) malloc((size_t)((9*ch->n+1)*sizeof(int)));
+	Ax = (double *) malloc((size_t)((9*ch->n+1)*sizeof(double)));
+	parent = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	ancestor = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	mark = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	s = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	c = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	ch->Lp = (int *) malloc((size_t)((ch->n+1)*sizeof(int)));
+	if(ch->cell_i == NULL || ch->cell_j == NULL || ch->x == NULL || Ap == NULL || Ai == NULL ||
+			Ax == NULL || parent == NULL || ancestor == NULL || mark == NULL || s == NULL ||
+			c == NULL || ch->Lp == NULL) {
+		ERROR("Storage cannot be allocated");
+	}
+
+	nested_dissection(ch, 1, imax, 1, jmax, Flag, &next);
+
+	/* a corner cell takes the mean of its two fluid neighbours, which couples them diagonally:
+	 * cnw[i][j] couples (i,j) and (i-1,j+1), csw[i][j] couples (i,j) and (i-1,j-1) */
+	cnw = matrix(0, imax+1, 0, jmax+1);
+	csw = matrix(0, imax+1, 0, jmax+1);
+	init_matrix(cnw, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(csw, 0, imax+1, 0, jmax+1, 0.0);
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			switch(Flag[i][j]&31) {
+			case B_NO: cnw[i+1][j] += w; break;
+			case B_NW: csw[i][j+1] += w; break;
+			case B_SO: csw[i+1][j] += w; break;
+			case B_SW: cnw[i][j-1] += w; break;
+			default: break;
+			}
+		}
+	}
+
+	/* upper triangle of the negative Laplacian, column by column in the new order */
+	nnz = 0;
+	for(k = 0; k < ch->n; k++) {
+		i = ch->cell_i[k];
+		j = ch->cell_j[k];
+		Ap[k] = nnz;
+		ni[0] = i-1; nj[0] = j;   nc[0] = cx;
+		ni[1] = i+1; nj[1] = j;   nc[1] = cx;
+		ni[2] = i;   nj[2] = j-1; nc[2] = cy;
+		ni[3] = i;   nj[3] = j+1; nc[3] = cy;
+		ni[4] = i-1; nj[4] = j+1; nc[4] = cnw[i][j];
+		ni[5] = i-1; nj[5] = j-1; nc[5] = csw[i][j];
+		ni[6] = i+1; nj[6] = j-1; nc[6] = cnw[i+1][j-1];
+		ni[7] = i+1; nj[7] = j+1; nc[7] = csw[i+1][j+1];
+		d = 0.0;
+		for(q = 0; q < 8; q++) {
+			p = ch->index[ni[q]][nj[q]];
+			if(p >= 0 && nc[q] > 0.0) {
+				d += nc[q];
+				if(p < k) {
+					Ai[nnz] = p;
+					Ax[nnz] = -nc[q];
+					nnz++;
+				}
+			}
+		}
+		if(i == 1 && ch->left_dirichlet) d += 2.0*cx;
+		if(i == imax && ch->right_dirichlet) d += 2.0*cx;
+		Ai[nnz] = k;
+		Ax[nnz] = (d > 0.0) ? d : 1.0;
+		nnz++;
+	}
+	Ap[ch->n] = nnz;
+
+	/* elimination tree */
+	for(k = 0; k < ch->n; k++) {
+		parent[k] = -1;
+		ancestor[k] = -1;
+		for(p = Ap[k]; p < Ap[k+1]; p++) {
+			for(i = Ai[p]; i != -1 && i < k; i = inext) {
+				inext = ancestor[i];
+				ancestor[i] = k;
+				if(inext == -1) {
+					parent[i] = k;
+				}
+			}
+		}
+	}
+
+	/* column counts of L from the row patterns */
+	for(k = 0; k < ch->n; k++) {
+		c[k] = 1;
+		mark[k] = -1;
+	}
+	for(k = 0; k < ch->n; k++) {
+		for(top = ereach(k, Ap, Ai, parent, s, mark, ch->n); top < ch->n; top++) {
+			c[s[top]]++;
+		}
+	}
+	nnz = 0;
+	for(k = 0; k < ch->n; k++) {
+		ch->Lp[k] = nnz;
+		nnz += c[k];
+		c[k] = ch->Lp[k];
+		mark[k] = -1;
+		ch->x[k] = 0.0;
+	}
+	ch->Lp[ch->n] = nnz;
+	ch->Li = (int *) malloc((size_t)((nnz+1)*sizeof(int)));
+	ch->Lx = (double *) malloc((size_t)((nnz+1)*sizeof(double)));
+	if(ch->Li == NULL || ch->Lx == NULL) ERROR("Storage cannot be allocated");
+
+	/* up-looking factorization: row k of L is a sparse triangular solve with the rows above */
+	for(k = 0; k < ch->n; k++) {
+		top = ereach(k, Ap, Ai, parent, s, mark, ch->n);
+		for(p = Ap[k]; p < Ap[k+1]; p++) {
+			ch->x[Ai[p]] = Ax[p];
+		}
+		d = ch->x[k];
+		ch->x[k] = 0.0;
+		for(; top < ch->n; top++) {
+			i = s[top];
+			lki = ch->x[i]/ch->Lx[ch->Lp[i]];
+			ch->x[i] = 0.0;
+			for(p = ch->Lp[i]+1; p < c[i]; p++) {
+				ch->x[ch->Li[p]] -= ch->Lx[p]*lki;
+			}
+			d -= lki*lki;
+			p = c[i]++;
+			ch->Li[p] = k;
+			ch->Lx[p] = lki;
+		}
+		/* The pure Neumann problem is singular, its last pivot vanishes. Replacing it by the
+		 * diagonal fixes that unknown to 0 for a mean free right hand side. */
+		if(d <= 1e-10*Ax[Ap[k+1]-1]) {
+			d = Ax[Ap[k+1]-1];
+		}
+		p = c[k]++;
+		ch->Li[p] = k;
+		ch->Lx[p] = sqrt(d);
+	}
+	printf("Cholesky: %i unknowns, %i nonzeros in A, %i nonzeros in L (nested dissection)\n",
+			ch->n, 2*Ap[ch->n]-ch->n, nnz);
+
+	free_matrix(cnw, 0, imax+1, 0, jmax+1);
+	free_matrix(csw, 0, imax+1, 0, jmax+1);
+	free(Ap);
+	free(Ai);
+	free(Ax);
+	free(parent);
+	free(ancestor);
+	free(mark);
+	free(s);
+	free(c);
+}
+
+/* x = (L L^T)^-1 x */
+static void substitute(const cholesky *ch, double *x)
+{
+	int k, p;
+
+	/* L y = b */
+	for(k = 0; k < ch->n; k++) {
+		x[k] /= ch->Lx[ch->Lp[k]];
+		for(p = ch->Lp[k]+1; p < ch->Lp[k+1]; p++) {
+			x[ch->Li[p]] -= ch->Lx[p]*x[k];
+		}
+	}
+	/* L^T x = y */
+	for(k = ch->n-1; k >= 0; k--) {
+		for(p = ch->Lp[k]+1; p < ch->Lp[k+1]; p++) {
+			x[k] -= ch->Lx[p]*x[ch->Li[p]];
+		}
+		x[k] /= ch->Lx[ch->Lp[k]];
+	}
+}
+
+int chol_solve(
+		cholesky *ch,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double eps,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag
+){
+	int i, j, k;
+	int solves = 1;
+	int neumann = !ch->left_dirichlet && !ch->right_dirichlet && ch->n > 0;
+	double cx = 1.0/(dx*dx);
+	double cy = 1.0/(dy*dy);
+	double mean = 0.0, mean_old = 0.0, mean_new = 0.0;
+	double res_old;
+	/* boundary pressures as set by set_outer_pressure() */
+	double gl = (lp >= 0) ? lp : dp;
+	double gr = (rp >= 0) ? rp : 0.0;
+	double *x = ch->x;
+
+	/* right hand side -RS, the Dirichlet values of the ghost cells are moved to it */
+	for(k = 0; k < ch->n; k++) {
+		i = ch->cell_i[k];
+		j = ch->cell_j[k];
+		x[k] = -RS[i][j];
+		if(i == 1 && ch->left_dirichlet) x[k] += 2.0*gl*cx;
+		if(i == imax && ch->right_dirichlet) x[k] += 2.0*gr*cx;
+		mean += x[k];
+		mean_old += P[i][j];
+	}
+	if(neumann) {
+		mean /= ch->n;
+		for(k = 0; k < ch->n; k++) {
+			x[k] -= mean;
+		}
+	}
+
+	substitute(ch, x);
+
+	for(k = 0; k < ch->n; k++) {
+		mean_new += x[k];
+	}
+	/* the pure Neumann problem determines P up to a constant, keep the previous one */
+	mean = 0.0;
+	if(neumann) {
+		mean = (mean_old - mean_new)/ch->n;
+	}
+	for(k = 0; k < ch->n; k++) {
+		P[ch->cell_i[k]][ch->cell_j[k]] = x[k] + mean;
+	}
+
+	set_obstacle_pressure(imax, jmax, P, Flag);
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+	*res = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+
+	/* Where the factorized corner couplings differ from sor() (dx != dy), correct P with the
+	 * residual of the ghost cells that set_obstacle_pressure() really sets. */
+	while(*res > eps && solves < CHOL_SOLVES) {
+		mean = 0.0;
+		for(k = 0; k < ch->n; k++) {
+			i = ch->cell_i[k];
+			j = ch->cell_j[k];
+			x[k] = cx*(P[i+1][j]-2.0*P[i][j]+P[i-1][j]) + cy*(P[i][j+1]-2.0*P[i][j]+P[i][j-1]) - RS[i][j];
+			mean += x[k];
+		}
+		if(neumann) {
+			mean /= ch->n;
+			for(k = 0; k < ch->n; k++) {
+				x[k] -= mean;
+			}
+		}
+		substitute(ch, x);
+		for(k = 0; k < ch->n; k++) {
+			P[ch->cell_i[k]][ch->cell_j[k]] += x[k];
+		}
+		set_obstacle_pressure(imax, jmax, P, Flag);
+		set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+		res_old = *res;
+		*res = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+		solves++;
+		if(*res >= res_old) {
+			break;
+		}
+	}
+	return solves;
+}
+
+void chol_free(cholesky *ch, int imax, int jmax)
+{
+	free_imatrix(ch->index, 0, imax+1, 0, jmax+1);
+	free(ch->cell_i);
+	free(ch->cell_j);
+	free(ch->x);
+	free(ch->Lp);
+	free(ch->Li);
+	free(ch->Lx);
+}
@@ -0,0 +1,70 @@
+#ifndef __CHOLESKY_H_
+#define __CHOLESKY_H_
+
+#include "helper.h"
+
+/* most solves with the factorization in one time step, see chol_solve() */
+#define CHOL_SOLVES 8
+
+/**
+ * Direct solver for the pressure equation. The negative 5-point Laplacian on the fluid cells
+ * (Neumann faces to obstacles and walls, Dirichlet faces to P_L/P_R boundaries and the diagonal
+ * couplings of the corner cells, as in the PCG solver) does not change during a run, so it is
+ * factorized once as L L^T. The fluid cells are numbered in nested dissection order to keep the
+ * fill-in of L small, every time step is then one forward and one backward substitution. L is
+ * stored column by column (CSC).
+ */
+typedef struct {
+  int n;                /* number of fluid cells (unknowns) */
+  int left_dirichlet;   /* P_L: the left boundary has a prescribed pressure */
+  int right_dirichlet;  /* P_R: the right boundary has a prescribed pressure */
+  int **index;          /* index[i][j]: unknown of the fluid cell (i,j), -1 otherwise */
+  int *cell_i;          /* cell of every unknown */
+  int *cell_j;
+  int *Lp;              /* column pointers of L, the diagonal is the first entry of a column */
+  int *Li;              /* row indices of L */
+  double *Lx;           /* values of L */
+  double *x;            /* right hand side and solution in the order of the unknowns */
+} cholesky;
+
+/**
+ * Orders the fluid cells by nested dissection and computes the Cholesky factorization.
+ */
+void chol_init(
+  cholesky *ch,
+  int imax,
+  int jmax,
+  double dx,
+  double dy,
+  uint8_t **Flag
+);
+
+/**
+ * Solves the pressure equation with the factorization. P is overwritten including the boundary
+ * values and the residual of calculate_res() is stored in res. Without a Dirichlet boundary the
+ * mean of P is kept. For dx != dy the factorized corner couplings are the symmetric mean of
+ * those of sor(), the solve is then repeated with the residual until it is below eps, stops
+ * decreasing or CHOL_SOLVES solves are done. Returns the number of solves.
+ */
+int chol_solve(
+  cholesky *ch,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  double eps,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag
+);
+
+/**
+ * Frees the factorization.
+ */
+void chol_free(cholesky *ch, int imax, int jmax);
+
+#endif
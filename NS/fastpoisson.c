@@ -0,0 +1,574 @@
+#include "fastpoisson.h"
+#include "sor.h"
+#include "helper.h"
+#include <math.h>
+#include <string.h>
+
+int obstacle_free(int imax, int jmax, uint8_t **Flag)
+{
+	int i, j;
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if((Flag[i][j]&B_C)!=B_C) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+static double *alloc_vector(int n)
+{
+	double *v = (double *) malloc((size_t)(n*sizeof(double)));
+	if(v == NULL) ERROR("Storage cannot be allocated");
+	return v;
+}
+
+/* sin(2 pi/3), cos and sin of 2 pi/5 and 4 pi/5 for the radix 3 and 5 butterflies */
+#define FFT_S3  0.86602540378443864676
+#define FFT_C5  0.30901699437494742410
+#define FFT_C52 (-0.80901699437494742410)
+#define FFT_S5  0.95105651629515357212
+#define FFT_S52 0.58778525229247312917
+
+/*
+ * Radix steps: out = DFT of the n values in[0], in[stride], ..., which are the DFTs of the p
+ * decimated sequences of length n/p combined by a DFT of length p = factor[f]. The twiddle
+ * factor W_n^e is W_N^(e stride) of the table of the full length N.
+ */
+static void fft_radix(const fft_plan *pl, const double *in, double *out, int n, int stride, int f)
+{
+	int p, m, q, s, k, e, de, ds;
+	double t[2*FFT_RADIX_MAX];
+	double wr, wi, re, im, ar, ai, br, bi, cr, ci, dr, di;
+	const int N = pl->n;
+	const double *tw = pl->twiddle;
+
+	p = pl->factor[f];
+	m = n/p;
+	if(m == 1) {
+		for(q = 0; q < p; q++) {
+			out[2*q] = in[2*q*stride];
+			out[2*q+1] = in[2*q*stride+1];
+		}
+	}
+	else {
+		for(q = 0; q < p; q++) {
+			fft_radix(pl, in + 2*q*stride, out + 2*q*m, m, stride*p, f+1);
+		}
+	}
+	for(k = 0; k < m; k++) {
+		/* t[q] = W_n^(qk) * (DFT q)[k] */
+		t[0] = out[2*k];
+		t[1] = out[2*k+1];
+		de = k*stride;
+		for(q = 1, e = de; q < p; q++, e += de) {
+			re = out[2*(q*m+k)];
+			im = out[2*(q*m+k)+1];
+			t[2*q] = re*tw[2*e] - im*tw[2*e+1];
+			t[2*q+1] = re*tw[2*e+1] + im*tw[2*e];
+		}
+		if(p == 2) {
+			out[2*k] = t[0] + t[2];
+			out[2*k+1] = t[1] + t[3];
+			out[2*(m+k)] = t[0] - t[2];
+			out[2*(m+k)+1] = t[1] - t[3];
+		}
+		else if(p == 4) {
+			/* W_4 = -i */
+			ar = t[0] + t[4]; ai = t[1] + t[5];
+			br = t[0] - t[4]; bi = t[1] - t[5];
+			cr = t[2] + t[6]; ci = t[3] + t[7];
+			dr = t[3] - t[7]; di = t[6] - t[2];
+			out[2*k] = ar + cr;
+			out[2*k+1] = ai + ci;
+			out[2*(m+k)] = br + dr;
+			out[2*(m+k)+1] = bi + di;
+			out[2*(2*m+k)] = ar - cr;
+			out[2*(2*m+k)+1] = ai - ci;
+			out[2*(3*m+k)] = br - dr;
+			out[2*(3*m+k)+1] = bi - di;
+		}
+		else if(p == 3) {
+			ar = t[2] + t[4]; ai = t[3] + t[5];
+			br = FFT_S3*(t[2] - t[4]); bi = FFT_S3*(t[3] - t[5]);
+			cr = t[0] - 0.5*ar; ci = t[1] - 0.5*ai;
+			out[2*k] = t[0] + ar;
+			out[2*k+1] = t[1] + ai;
+			out[2*(m+k)] = cr + bi;
+			out[2*(m+k)+1] = ci - br;
+			out[2*(2*m+k)] = cr - bi;
+			out[2*(2*m+k)+1] = ci + br;
+		}
+		else if(p == 5) {
+			ar = t[2] + t[8]; ai = t[3] + t[9];
+			br = t[2] - t[8]; bi = t[3] - t[9];
+			cr = t[4] + t[6]; ci = t[5] + t[7];
+			dr = t[4] - t[6]; di = t[5] - t[7];
+			out[2*k] = t[0] + ar + cr;
+			out[2*k+1] = t[1] + ai + ci;
+			/* outputs 1 and 4 */
+			re = t[0] + FFT_C5*ar + FFT_C52*cr;
+			im = t[1] + FFT_C5*ai + FFT_C52*ci;
+			wr = FFT_S5*br + FFT_S52*dr;
+			wi = FFT_S5*bi + FFT_S52*di;
+			out[2*(m+k)] = re + wi;
+			out[2*(m+k)+1] = im - wr;
+			out[2*(4*m+k)] = re - wi;
+			out[2*(4*m+k)+1] = im + wr;
+			/* outputs 2 and 3 */
+			re = t[0] + FFT_C52*ar + FFT_C5*cr;
+			im = t[1] + FFT_C52*ai + FFT_C5*ci;
+			wr = FFT_S52*br - FFT_S5*dr;
+			wi = FFT_S52*bi - FFT_S5*di;
+			out[2*(2*m+k)] = re + wi;
+			out[2*(2*m+k)+1] = im - wr;
+			out[2*(3*m+k)] = re - wi;
+			out[2*(3*m+k)+1] = im + wr;
+		}
+		else {
+			for(s = 0; s < p; s++) {
+				/* W_p^(qs) = W_N^((qs mod p) N/p) */
+				re = t[0];
+				im = t[1];
+				ds = s*(N/p);
+				for(q = 1, e = ds; q < p; q++) {
+					wr = tw[2*e];
+					wi = tw[2*e+1];
+					re += t[2*q]*wr - t[2*q+1]*wi;
+					im += t[2*q]*wi + t[2*q+1]*wr;
+					e += ds;
+					if(e >= N) {
+						e -= N;
+					}
+				}
+				out[2*(s*m+k)] = re;
+				out[2*(s*m+k)+1] = im;
+			}
+		}
+	}
+}
+
+/*
+ * In place FFT of the complex vector x (real and imaginary parts interleaved) of the plan's
+ * length. The inverse transform (conjugate of the transform of the conjugate) is not scaled.
+ */
+static void fft(fft_plan *pl, double *x, int inverse)
+{
+	int k, n = pl->n, m = pl->m;
+	double re, im;
+	double *a = pl->pad;
+
+	if(inverse) {
+		for(k = 0; k < n; k++) {
+			x[2*k+1] = -x[2*k+1];
+		}
+	}
+	if(pl->inner == NULL) {
+		fft_radix(pl, x, pl->buf, n, 1, 0);
+		for(k = 0; k < 2*n; k++) {
+			x[k] = pl->buf[k];
+		}
+	}
+	else {
+		/* a = x chirp, zero padded, convolved with the conjugate chirp, times the chirp */
+		for(k = 0; k < n; k++) {
+			a[2*k] = x[2*k]*pl->chirp[2*k] - x[2*k+1]*pl->chirp[2*k+1];
+			a[2*k+1] = x[2*k]*pl->chirp[2*k+1] + x[2*k+1]*pl->chirp[2*k];
+		}
+		for(k = 2*n; k < 2*m; k++) {
+			a[k] = 0.0;
+		}
+		fft(pl->inner, a, 0);
+		for(k = 0; k < m; k++) {
+			re = a[2*k]*pl->kernel[2*k] - a[2*k+1]*pl->kernel[2*k+1];
+			im = a[2*k]*pl->kernel[2*k+1] + a[2*k+1]*pl->kernel[2*k];
+			a[2*k] = re;
+			a[2*k+1] = im;
+		}
+		fft(pl->inner, a, 1);
+		for(k = 0; k < n; k++) {
+			x[2*k] = a[2*k]*pl->chirp[2*k] - a[2*k+1]*pl->chirp[2*k+1];
+			x[2*k+1] = a[2*k]*pl->chirp[2*k+1] + a[2*k+1]*pl->chirp[2*k];
+		}
+	}
+	if(inverse) {
+		for(k = 0; k < n; k++) {
+			x[2*k+1] = -x[2*k+1];
+		}
+	}
+}
+
+static void fft_plan_init(fft_plan *pl, int n)
+{
+	int k, p, r;
+	double a;
+
+	pl->n = n;
+	pl->nfactor = 0;
+	pl->m = 0;
+	pl->chirp = pl->kernel = pl->pad = NULL;
+	pl->inner = NULL;
+	for(r = n; r % 4 == 0 && pl->nfactor < FFT_MAX_FACTORS - 1; r /= 4) {
+		pl->factor[pl->nfactor++] = 4;
+	}
+	for(p = 2; r > 1; ) {
+		if(r % p == 0) {
+			pl->factor[pl->nfactor++] = p;
+			r /= p;
+		}
+		else {
+			p++;
+		}
+	}
+	pl->twiddle = alloc_vector(2*n);
+	pl->buf = alloc_vector(2*n);
+	for(k = 0; k < n; k++) {
+		pl->twiddle[2*k] = cos(2.0*M_PI*k/n);
+		pl->twiddle[2*k+1] = -sin(2.0*M_PI*k/n);
+	}
+	if(pl->nfactor == 0 || pl->factor[pl->nfactor-1] <= FFT_RADIX_MAX) {
+		return;
+	}
+
+	/* Bluestein: nk = (k^2 + n^2 - (k-n)^2)/2 turns the DFT into a convolution with the chirp */
+	pl->nfactor = 0;
+	for(pl->m = 1; pl->m < 2*n-1; pl->m *= 2);
+	pl->chirp = alloc_vector(2*n);
+	pl->kernel = alloc_vector(2*pl->m);
+	pl->pad = alloc_vector(2*pl->m);
+	pl->inner = (fft_plan *) malloc(sizeof(fft_plan));
+	if(pl->inner == NULL) ERROR("Storage cannot be allocated");
+	fft_plan_init(pl->inner, pl->m);
+	for(k = 0; k < n; k++) {
+		/* k^2 mod 2n keeps the angle accurate for large k */
+		a = M_PI*(double)(((long)k*k) % (2L*n))/n;
+		pl->chirp[2*k] = cos(a);
+		pl->chirp[2*k+1] = -sin(a);
+	}
+	for(k = 0; k < 2*pl->m; k++) {
+		pl->kernel[k] = 0.0;
+	}
+	for(k = 0; k < n; k++) {
+		pl->kernel[2*k] = pl->chirp[2*k];
+		pl->kernel[2*k+1] = -pl->chirp[2*k+1];
+		if(k > 0) {
+			pl->kernel[2*(pl->m-k)] = pl->chirp[2*k];
+			pl->kernel[2*(pl->m-k)+1] = -pl->chirp[2*k+1];
+		}
+	}
+	fft(pl->inner, pl->kernel, 0);
+	for(k = 0; k < 2*pl->m; k++) {
+		pl->kernel[k] /= pl->m;
+	}
+}
+
+static void fft_plan_free(fft_plan *pl)
+{
+	free(pl->twiddle);
+	free(pl->buf);
+	if(pl->inner != NULL) {
+		fft_plan_free(pl->inner);
+		free(pl->inner);
+		free(pl->chirp);
+		free(pl->kernel);
+		free(pl->pad);
+	}
+}
+
+/*
+ * Scaled DCT-II of the n values x[j]-d, X[k] = scale[k] sum_j (x[j]-d) cos(pi k (j+1/2) / n),
+ * by one complex FFT of length n: the even values in order followed by the odd ones in
+ * reverse order are transformed, X[k] is the real part of the result times exp(-i pi k/(2n)).
+ * Two lines x1, x2 are transformed together as the real and imaginary part, their transforms
+ * are the even and odd parts of the result. x2 may be NULL.
+ */
+static void cosine_forward(fastpoisson_solver *fp, int n, const double *x1, double d1, double *X1,
+		const double *x2, double d2, double *X2)
+{
+	int j, k;
+	double a, b, c, e;
+	double *w = fp->work;
+
+	for(j = 0; 2*j < n; j++) {
+		w[2*j] = x1[2*j] - d1;
+		w[2*j+1] = (x2 != NULL) ? x2[2*j] - d2 : 0.0;
+	}
+	for(j = 0; 2*j+1 < n; j++) {
+		w[2*(n-1-j)] = x1[2*j+1] - d1;
+		w[2*(n-1-j)+1] = (x2 != NULL) ? x2[2*j+1] - d2 : 0.0;
+	}
+	fft(&fp->plan, w, 0);
+	for(k = 0; k < n; k++) {
+		/* V1 = (V[k] + conj V[n-k])/2, V2 = (V[k] - conj V[n-k])/(2i) */
+		a = w[2*k];
+		b = w[2*k+1];
+		c = w[2*((n-k)%n)];
+		e = w[2*((n-k)%n)+1];
+		X1[k] = 0.5*fp->scale[k]*((a+c)*fp->shift[2*k] + (b-e)*fp->shift[2*k+1]);
+		if(x2 != NULL) {
+			X2[k] = 0.5*fp->scale[k]*((b+e)*fp->shift[2*k] - (a-c)*fp->shift[2*k+1]);
+		}
+	}
+}
+
+/*
+ * DCT-III, the inverse of cosine_forward(): y[j] = sum_k Q[k] cos(pi k (j+1/2) / n). The
+ * coefficients are turned back into the FFT of the reordered values, which an inverse FFT
+ * of length n returns. Two lines are transformed together as the real and imaginary part,
+ * Q2 may be NULL.
+ */
+static void cosine_inverse(fastpoisson_solver *fp, int n, const double *Q1, double *y1,
+		const double *Q2, double *y2)
+{
+	int j, k;
+	double a, b, c, e;
+	double *w = fp->work;
+
+	for(k = 0; k < n; k++) {
+		/* W = exp(i pi k/(2n)) (Q[k] - i Q[n-k]) / 2 for k > 0, the real spectrum of one line */
+		a = (k == 0) ? Q1[0] : 0.5*Q1[k];
+		b = (k == 0) ? 0.0 : -0.5*Q1[n-k];
+		w[2*k] = a*fp->shift[2*k] - b*fp->shift[2*k+1];
+		w[2*k+1] = a*fp->shift[2*k+1] + b*fp->shift[2*k];
+		if(Q2 != NULL) {
+			/* plus i times the spectrum of the second line */
+			c = (k == 0) ? Q2[0] : 0.5*Q2[k];
+			e = (k == 0) ? 0.0 : -0.5*Q2[n-k];
+			w[2*k] -= c*fp->shift[2*k+1] + e*fp->shift[2*k];
+			w[2*k+1] += c*fp->shift[2*k] - e*fp->shift[2*k+1];
+		}
+	}
+	fft(&fp->plan, w, 1);
+	for(j = 0; 2*j < n; j++) {
+		y1[2*j] = w[2*j];
+		if(Q2 != NULL) {
+			y2[2*j] = w[2*j+1];
+		}
+	}
+	for(j = 0; 2*j+1 < n; j++) {
+		y1[2*j+1] = w[2*(n-1-j)];
+		if(Q2 != NULL) {
+			y2[2*j+1] = w[2*(n-1-j)+1];
+		}
+	}
+}
+
+void fp_init(
+		fastpoisson_solver *fp,
+		int imax,
+		int jmax,
+		double dx,
+		double dy,
+		uint8_t **Flag
+){
+	int i, j, k;
+	char radix[16*FFT_MAX_FACTORS];
+	double rdx2 = 1.0/(dx*dx);
+	double mu, a, b, c, denom;
+
+	/* P_L and P_R are set for the whole left/right column, see init_flag() */
+	fp->left_dirichlet = (Flag[0][1]&P_L)==P_L;
+	fp->right_dirichlet = (Flag[imax+1][1]&P_R)==P_R;
+
+	fp->fft = jmax >= FP_FFT_MIN;
+	fp->scale = (double *) malloc((size_t)(jmax*sizeof(double)));
+	if(fp->scale == NULL) ERROR("Storage cannot be allocated");
+	fp->upper = matrix(1, imax, 0, jmax-1);
+	fp->inv_pivot = matrix(1, imax, 0, jmax-1);
+	fp->Q = matrix(1, imax, 0, jmax-1);
+
+	if(fp->fft) {
+		fp->cosine = NULL;
+		fft_plan_init(&fp->plan, jmax);
+		fp->shift = alloc_vector(2*jmax);
+		fp->work = alloc_vector(2*jmax);
+		for(k = 0; k < jmax; k++) {
+			fp->shift[2*k] = cos(M_PI*k/(2.0*jmax));
+			fp->shift[2*k+1] = sin(M_PI*k/(2.0*jmax));
+		}
+	}
+	else {
+		fp->shift = fp->work = NULL;
+		fp->cosine = matrix(1, jmax, 0, jmax-1);
+		for(j = 1; j <= jmax; j++) {
+			for(k = 0; k < jmax; k++) {
+				fp->cosine[j][k] = cos(M_PI*k*(j-0.5)/jmax);
+			}
+		}
+	}
+	for(k = 0; k < jmax; k++) {
+		fp->scale[k] = (k == 0) ? 1.0/jmax : 2.0/jmax;
+	}
+
+	/*
+	 * Mode k of the y-direction has the eigenvalue mu = (2cos(pi k/jmax) - 2)/dy^2, the
+	 * tridiagonal system of the mode is a Q[i-1] + b Q[i] + c Q[i+1] = R[i]. A Neumann
+	 * boundary adds, a Dirichlet boundary removes one coupling from the boundary cell.
+	 */
+	for(k = 0; k < jmax; k++) {
+		mu = (2.0*cos(M_PI*k/jmax) - 2.0)/(dy*dy);
+		for(i = 1; i <= imax; i++) {
+			a = (i > 1) ? rdx2 : 0.0;
+			c = (i < imax) ? rdx2 : 0.0;
+			b = -2.0*rdx2 + mu;
+			if(i == 1) b += fp->left_dirichlet ? -rdx2 : rdx2;
+			if(i == imax) b += fp->right_dirichlet ? -rdx2 : rdx2;
+			denom = b - ((i > 1) ? a*fp->upper[i-1][k] : 0.0);
+			/* the mean mode of the pure Neumann problem is singular, its last value is fixed to 0 */
+			if(fabs(denom) < 1e-12*(2.0*rdx2 - mu)) {
+				fp->inv_pivot[i][k] = 0.0;
+				fp->upper[i][k] = 0.0;
+			}
+			else {
+				fp->inv_pivot[i][k] = 1.0/denom;
+				fp->upper[i][k] = c/denom;
+			}
+		}
+	}
+	if(fp->fft && fp->plan.inner != NULL) {
+		printf("Obstacle free domain: pressure is solved directly by a cosine transform (FFT of length %i by Bluestein's algorithm with FFTs of length %i, O(jmax log jmax) per line)\n",
+				jmax, fp->plan.m);
+	}
+	else if(fp->fft) {
+		radix[0] = '\0';
+		for(k = 0; k < fp->plan.nfactor; k++) {
+			sprintf(radix + strlen(radix), k > 0 ? "x%i" : "%i", fp->plan.factor[k]);
+		}
+		printf("Obstacle free domain: pressure is solved directly by a cosine transform (mixed radix FFT of length %i = %s, O(jmax log jmax) per line)\n",
+				jmax, radix);
+	}
+	else {
+		printf("Obstacle free domain: pressure is solved directly by a cosine transform (cosine table, O(jmax^2) per line for jmax < %i)\n", FP_FFT_MIN);
+	}
+}
+
+/*
+ * The Dirichlet values of the ghost cells moved to the right hand side of line i, they are
+ * subtracted from RS.
+ */
+static double dirichlet_rhs(const fastpoisson_solver *fp, int i, int imax, double gl, double gr, double rdx2)
+{
+	double d = 0.0;
+	if(i == 1 && fp->left_dirichlet) d += 2.0*gl*rdx2;
+	if(i == imax && fp->right_dirichlet) d += 2.0*gr*rdx2;
+	return d;
+}
+
+void fp_solve(
+		fastpoisson_solver *fp,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag
+){
+	int i, j, k;
+	double rdx2 = 1.0/(dx*dx);
+	double sum, rhs, mean_old = 0.0, mean_new = 0.0;
+	/* boundary pressures as set by set_outer_pressure() */
+	double gl = (lp >= 0) ? lp : dp;
+	double gr = (rp >= 0) ? rp : 0.0;
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			mean_old += P[i][j];
+		}
+	}
+
+	/* cosine transform of the right hand side in y-direction, the Dirichlet values go to the
+	 * right hand side of the boundary cells */
+	if(fp->fft) {
+		/* two lines per FFT */
+		for(i = 1; i <= imax; i += 2) {
+			if(i < imax) {
+				cosine_forward(fp, jmax, &RS[i][1], dirichlet_rhs(fp, i, imax, gl, gr, rdx2), fp->Q[i],
+						&RS[i+1][1], dirichlet_rhs(fp, i+1, imax, gl, gr, rdx2), fp->Q[i+1]);
+			}
+			else {
+				cosine_forward(fp, jmax, &RS[i][1], dirichlet_rhs(fp, i, imax, gl, gr, rdx2), fp->Q[i],
+						NULL, 0.0, NULL);
+			}
+		}
+	}
+	for(i = 1; i <= imax && !fp->fft; i++) {
+		for(k = 0; k < jmax; k++) {
+			sum = 0.0;
+			for(j = 1; j <= jmax; j++) {
+				rhs = RS[i][j];
+				if(i == 1 && fp->left_dirichlet) rhs -= 2.0*gl*rdx2;
+				if(i == imax && fp->right_dirichlet) rhs -= 2.0*gr*rdx2;
+				sum += rhs*fp->cosine[j][k];
+			}
+			fp->Q[i][k] = fp->scale[k]*sum;
+		}
+	}
+
+	/* tridiagonal solve of every mode in x-direction */
+	for(k = 0; k < jmax; k++) {
+		fp->Q[1][k] *= fp->inv_pivot[1][k];
+		for(i = 2; i <= imax; i++) {
+			fp->Q[i][k] = (fp->Q[i][k] - rdx2*fp->Q[i-1][k])*fp->inv_pivot[i][k];
+		}
+		for(i = imax-1; i >= 1; i--) {
+			fp->Q[i][k] -= fp->upper[i][k]*fp->Q[i+1][k];
+		}
+	}
+
+	/* inverse transform */
+	if(fp->fft) {
+		for(i = 1; i <= imax; i += 2) {
+			cosine_inverse(fp, jmax, fp->Q[i], &P[i][1], i < imax ? fp->Q[i+1] : NULL, i < imax ? &P[i+1][1] : NULL);
+		}
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				mean_new += P[i][j];
+			}
+		}
+	}
+	for(i = 1; i <= imax && !fp->fft; i++) {
+		for(j = 1; j <= jmax; j++) {
+			sum = 0.0;
+			for(k = 0; k < jmax; k++) {
+				sum += fp->Q[i][k]*fp->cosine[j][k];
+			}
+			P[i][j] = sum;
+			mean_new += sum;
+		}
+	}
+
+	/* the pure Neumann problem determines P up to a constant, keep the previous one */
+	if(!fp->left_dirichlet && !fp->right_dirichlet) {
+		sum = (mean_old - mean_new)/(imax*jmax);
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				P[i][j] += sum;
+			}
+		}
+	}
+
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+	*res = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+}
+
+void fp_free(fastpoisson_solver *fp, int imax, int jmax)
+{
+	if(fp->fft) {
+		fft_plan_free(&fp->plan);
+		free(fp->shift);
+		free(fp->work);
+	}
+	else {
+		free_matrix(fp->cosine, 1, jmax, 0, jmax-1);
+	}
+	free(fp->scale);
+	free_matrix(fp->upper, 1, imax, 0, jmax-1);
+	free_matrix(fp->inv_pivot, 1, imax, 0, jmax-1);
+	free_matrix(fp->Q, 1, imax, 0, jmax-1);
+}
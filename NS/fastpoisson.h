@@ -0,0 +1,96 @@
+#ifndef __FASTPOISSON_H_
+#define __FASTPOISSON_H_
+
+#include "helper.h"
+
+/* smallest jmax that is transformed by the FFT, smaller ones use the cosine table */
+#define FP_FFT_MIN 8
+/* largest prime factor of the FFT length done by a radix step, larger ones use Bluestein */
+#define FFT_RADIX_MAX 13
+/* enough factors for any int length */
+#define FFT_MAX_FACTORS 32
+
+/**
+ * Complex FFT of length n. n is split into its prime factors, each one is a radix step of a
+ * mixed radix Cooley-Tukey FFT. If n has a prime factor above FFT_RADIX_MAX, the transform is
+ * computed by Bluestein's algorithm as a convolution with a chirp, done by FFTs of the power of
+ * two length m >= 2n-1. Both are O(n log n).
+ */
+typedef struct fft_plan {
+  int n;                      /* length of the transform */
+  int nfactor;                /* radix steps, 0 with Bluestein's algorithm */
+  int factor[FFT_MAX_FACTORS];
+  double *twiddle;            /* exp(-2 pi i k/n), k < n, real and imaginary parts interleaved */
+  double *buf;                /* out of place work vector of the radix steps */
+  int m;                      /* length of the convolution of Bluestein's algorithm */
+  double *chirp;              /* exp(-i pi k^2/n), k < n */
+  double *kernel;             /* FFT of the conjugate chirp, wrapped to length m */
+  double *pad;                /* zero padded work vector of length m */
+  struct fft_plan *inner;     /* FFT of length m */
+} fft_plan;
+
+/**
+ * Direct solver for the pressure equation of a domain without obstacles. The equation is
+ * diagonalized in y-direction by a discrete cosine transform (DCT-II, the walls at the top
+ * and the bottom are homogeneous Neumann boundaries), every cosine mode is then a tridiagonal
+ * system in x-direction which is solved with the precomputed LU factors. The left and right
+ * boundary are Neumann boundaries or Dirichlet boundaries (P_L/P_R).
+ * For jmax >= FP_FFT_MIN the transforms are computed by a complex FFT of length jmax in
+ * O(jmax log jmax) per line, below as a product with the table of cosines in O(jmax^2).
+ */
+typedef struct {
+  int left_dirichlet;   /* P_L: the left boundary has a prescribed pressure */
+  int right_dirichlet;  /* P_R: the right boundary has a prescribed pressure */
+  int fft;              /* the transforms use the FFT */
+  double **cosine;      /* cosine[j][k] = cos(pi k (j-1/2) / jmax), without the FFT */
+  fft_plan plan;        /* FFT of length jmax */
+  double *shift;        /* cos and sin of pi k / (2 jmax), interleaved */
+  double *work;         /* complex work vector of the FFT, real and imaginary parts interleaved */
+  double *scale;        /* normalization of the forward transform of mode k */
+  double **upper;       /* upper[i][k]: eliminated upper diagonal of mode k */
+  double **inv_pivot;   /* inv_pivot[i][k]: inverse pivots of mode k (0 for a singular pivot) */
+  double **Q;           /* cosine coefficients of the right hand side and the solution */
+} fastpoisson_solver;
+
+/**
+ * Returns 1 if all interior cells of Flag are fluid cells.
+ */
+int obstacle_free(int imax, int jmax, uint8_t **Flag);
+
+/**
+ * Builds the tables of the transform and factorizes the tridiagonal systems of all modes.
+ */
+void fp_init(
+  fastpoisson_solver *fp,
+  int imax,
+  int jmax,
+  double dx,
+  double dy,
+  uint8_t **Flag
+);
+
+/**
+ * Solves the pressure equation directly. P is overwritten including the boundary values and
+ * the residual is stored in res. Without a Dirichlet boundary the mean of P is kept.
+ */
+void fp_solve(
+  fastpoisson_solver *fp,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag
+);
+
+/**
+ * Frees the tables of the solver.
+ */
+void fp_free(fastpoisson_solver *fp, int imax, int jmax);
+
+#endif
@@ -1,6 +1,9 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 #include "helper.h"
 
 /* ----------------------------------------------------------------------- */
@@ -388,8 +391,11 @@ double **matrix( int nrl, int nrh, int ncl, int nch )
     int nrow = nrh - nrl + 1;	/* compute number of lines */
     int ncol = nch - ncl + 1;	/* compute number of columns */
     
+    /* the rows are padded, the buffer is aligned and its size a multiple of the alignment */
+    int ld = (ncol + MATRIX_PAD - 1)/MATRIX_PAD*MATRIX_PAD;
+    size_t size = ((size_t)nrow*ld*sizeof(double) + MATRIX_ALIGN - 1)/MATRIX_ALIGN*MATRIX_ALIGN;
     double **pArray  = (double **) malloc((size_t)( nrow * sizeof(double*)) );
-    double  *pMatrix = (double *)  malloc((size_t)( nrow * ncol * sizeof( double )));
+    double  *pMatrix = (double *)  aligned_alloc(MATRIX_ALIGN, size);
     
     if( pArray  == 0)  ERROR("Storage cannot be allocated");
     if( pMatrix == 0)  ERROR("Storage cannot be allocated");
@@ -401,7 +407,7 @@ double **matrix( int nrl, int nrh, int ncl, int nch )
     /* compute the remaining array entries */
     for( i = 1; i < nrow; i++ )
     {
-        pArray[i] = pArray[i-1] + ncol;
+        pArray[i] = pArray[i-1] + ld;
     }
     
     /* return the value corrected by the beginning of a line */
@@ -436,8 +442,11 @@ int **imatrix( int nrl, int nrh, int ncl, int nch )
     int nrow = nrh - nrl + 1;	/* compute number of rows */
     int ncol = nch - ncl + 1;	/* compute number of columns */
     
+    /* same padding as matrix(), so a flag field has the leading dimension of the fields */
+    int ld = (ncol + MATRIX_PAD - 1)/MATRIX_PAD*MATRIX_PAD;
+    size_t size = ((size_t)nrow*ld*sizeof(int) + MATRIX_ALIGN - 1)/MATRIX_ALIGN*MATRIX_ALIGN;
     int **pArray  = (int **) malloc((size_t)( nrow * sizeof( int* )) );
-    int  *pMatrix = (int *)  malloc((size_t)( nrow * ncol * sizeof( int )));
+    int  *pMatrix = (int *)  aligned_alloc(MATRIX_ALIGN, size);
     
     
     if( pArray  == 0)  ERROR("Storage cannot be allocated");
@@ -450,7 +459,7 @@ int **imatrix( int nrl, int nrh, int ncl, int nch )
     /* compute the remaining array entries */
     for( i = 1; i < nrow; i++ )
     {
-        pArray[i] = pArray[i-1] + ncol;
+        pArray[i] = pArray[i-1] + ld;
     }
     
     /* return the value corrected by the beginning of a line */
@@ -476,6 +485,75 @@ void init_imatrix( int **m, int nrl, int nrh, int ncl, int nch, int a)
 }
 
 
+/* the fields are staggered by one cache line within this page size */
+#define FIELD_PAGE 4096
+/* alignment of the arena for transparent huge pages */
+#define FIELD_HUGEPAGE (2*1024*1024)
+
+void fields_init(fields *fl, int imax, int jmax, int hugepages)
+{
+    int i, k;
+    int nrow = imax + 2;
+    int ld = (jmax + 2 + MATRIX_PAD - 1)/MATRIX_PAD*MATRIX_PAD;
+    double ***dfield[8];
+    double **drows;
+    uint8_t **irows;
+    char *arena;
+
+    /* the row pointers, then the double fields and the flag field */
+    size_t tables = ((size_t)nrow*(8*sizeof(double*) + sizeof(uint8_t*)) + MATRIX_ALIGN - 1)/MATRIX_ALIGN*MATRIX_ALIGN;
+    size_t stride = ((size_t)nrow*ld*sizeof(double) + FIELD_PAGE - 1)/FIELD_PAGE*FIELD_PAGE + MATRIX_ALIGN;
+    size_t align = hugepages ? FIELD_HUGEPAGE : MATRIX_ALIGN;
+    size_t size = tables + 8*stride + (size_t)nrow*ld*sizeof(uint8_t);
+
+    size = (size + align - 1)/align*align;
+    arena = (char *) aligned_alloc(align, size);
+    if( arena == 0)  ERROR("Storage cannot be allocated");
+    if( hugepages )
+    {
+#ifdef MADV_HUGEPAGE
+        if( madvise(arena, size, MADV_HUGEPAGE) != 0 )
+            printf("Warning: no transparent huge pages for the fields (%s)\n", strerror(errno));
+#else
+        printf("Warning: huge pages are not supported on this system\n");
+#endif
+    }
+    /* also touches every page, in huge pages if granted */
+    memset(arena, 0, size);
+
+    dfield[0] = &fl->U;
+    dfield[1] = &fl->V;
+    dfield[2] = &fl->F;
+    dfield[3] = &fl->G;
+    dfield[4] = &fl->RS;
+    dfield[5] = &fl->P;
+    dfield[6] = &fl->P_prev;
+    dfield[7] = &fl->P_save;
+    drows = (double **) arena;
+    for( k = 0; k < 8; k++ )
+    {
+        *dfield[k] = drows + k*nrow;
+        (*dfield[k])[0] = (double *)(arena + tables + k*stride);
+        for( i = 1; i < nrow; i++ )
+            (*dfield[k])[i] = (*dfield[k])[i-1] + ld;
+    }
+    irows = (uint8_t **)(drows + 8*nrow);
+    irows[0] = (uint8_t *)(arena + tables + 8*stride);
+    for( i = 1; i < nrow; i++ )
+        irows[i] = irows[i-1] + ld;
+    fl->Flag = irows;
+
+    fl->arena = arena;
+    fl->size = size;
+}
+
+void fields_free(fields *fl)
+{
+    free( fl->arena );
+    fl->arena = 0;
+}
+
+
 int **read_pgm(const char *filename)
 {
     FILE *input = NULL;
@@ -557,3 +635,24 @@ int **read_pgm(const char *filename)
     
     return pic;
 }
+
+/* positions of the first boundary cells with flat index >= idx, see helper.h */
+void cell_lists_seek(const cell_lists *cells, int idx, int *kb)
+{
+    int k, lo, hi, mid;
+    for( k = 0; k < CELL_TYPES; k++ )
+    {
+        /* binary search in the ordered list of type k */
+        lo = 0;
+        hi = cells->nbnd[k];
+        while( lo < hi )
+        {
+            mid = (lo + hi)/2;
+            if( cells->bnd[k][mid] < idx )
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        kb[k] = lo;
+    }
+}
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <float.h>
 #include <time.h>
+#include <stdint.h>
 
 #ifdef PI
 #undef PI
@@ -28,6 +29,24 @@
 #define FREE_SLIP 2
 #define OUTFLOW 3
 
+/**
+ * Define pressure solvers
+ */
+#define SOLVER_SOR 0
+#define SOLVER_REDBLACK 1
+#define SOLVER_MULTIGRID 2
+#define SOLVER_PCG 3
+#define SOLVER_DCT 4
+#define SOLVER_CHOLESKY 5
+#define SOLVER_LINE 6
+
+/**
+ * Define preconditioners of the PCG solver
+ */
+#define PRECOND_JACOBI 0
+#define PRECOND_SSOR 1
+#define PRECOND_IC 2
+
 /**
  * Define obstacle cells
  */
@@ -52,6 +71,43 @@
  */
 #define P_L 32  /* 0b0100000*/
 #define P_R 64  /* 0b1000000*/
+
+/**
+ * Index of the boundary cell types in cell_lists
+ */
+enum { CELL_N, CELL_S, CELL_W, CELL_O, CELL_NO, CELL_NW, CELL_SO, CELL_SW, CELL_TYPES };
+
+/**
+ * Cell lists built from the flag field by init_flag(). The entries are flat indices
+ * mat_idx(i,j,ld) of the inner cells (1 <= i <= imax, 1 <= j <= jmax) in lexicographic
+ * order: fluid holds the fluid cells, bnd[CELL_N] ... bnd[CELL_SW] the obstacle cells of
+ * the boundary types B_N ... B_SW. The geometry is static, so the kernels loop over these
+ * lists instead of testing Flag in every cell. fluid_mask packs the fluid cells into bits,
+ * ldm words per row: cell (i,j) is a fluid cell if bit j%64 of word i*ldm + j/64 is set, so
+ * a word tells at once whether a block of 64 cells of a row is all fluid or all obstacle.
+ * The fluid cells of each column i (the cells j of a column are adjacent in memory) are also
+ * stored as runs of consecutive cells: the spans span_first[i] ... span_first[i+1]-1 of column
+ * i, where span k covers the flat indices span[2k] <= c < span[2k+1]. The kernels loop over
+ * the spans, so their work scales with the fluid area instead of the whole grid.
+ */
+typedef struct {
+	int nfluid;
+	int *fluid;
+	int nbnd[CELL_TYPES];
+	int *bnd[CELL_TYPES];
+	int ldm;
+	uint64_t *fluid_mask;
+	int nspan;
+	int *span_first;
+	int *span;
+} cell_lists;
+
+/**
+ * Sets kb[k] to the position of the first cell with flat index >= idx in the boundary
+ * list of type k, the start of a sweep over the boundary cells from that cell on.
+ */
+void cell_lists_seek(const cell_lists *cells, int idx, int *kb);
+
 /**
  * Stores the last timer value 
  */
@@ -226,6 +282,30 @@ void read_matrix( const char* szFileName,	               /* filehandle */
 		  int nch );                   /* last row */
 
 
+/**
+ * The matrices of matrix() and imatrix() are stored in one contiguous buffer aligned to
+ * MATRIX_ALIGN bytes, whose rows are padded to a multiple of MATRIX_PAD elements. All matrices
+ * with the same column range therefore have the same leading dimension (the distance of two
+ * rows in the buffer), and the kernels index the buffer directly with mat_idx() instead of
+ * loading a row pointer for every access.
+ */
+#define MATRIX_ALIGN 64
+#define MATRIX_PAD 8
+
+/**
+ * Leading dimension of a matrix from matrix() or imatrix().
+ */
+#define MATRIX_LD(m) ((int)((m)[1] - (m)[0]))
+
+/**
+ * Offset of element (i,j) from element (0,0) in a buffer with the leading dimension ld, so
+ * U[i][j] is U[0][mat_idx(i,j,ld)].
+ */
+static inline int mat_idx(int i, int j, int ld)
+{
+    return i*ld + j;
+}
+
 /**
  * matrix(...)        storage allocation for a matrix (nrl..nrh, ncl..nch)
  * free_matrix(...)   storage deallocation
@@ -306,6 +386,42 @@ void free_imatrix( int **m, int nrl, int nrh, int ncl, int nch );
  */
 void init_imatrix( int **m, int nrl, int nrh, int ncl, int nch, int a);
 
+/**
+ * The fields of the solver (0..imax+1, 0..jmax+1) in one arena. The fields are laid out in
+ * the order of the struct, so U and V are followed by F and G, which calculate_fg() writes
+ * from them, and each field starts on a cache line, one line further into the page than the
+ * last, so that the same cell of different fields does not map to the same cache set. The row
+ * pointers of the fields are part of the arena as well. The matrices have the layout of
+ * matrix(), with the same leading dimension for the flag field, which holds one byte per
+ * cell (the flags use 7 bits). They are released together with fields_free(), never with
+ * free_matrix().
+ */
+typedef struct {
+	double **U;
+	double **V;
+	double **F;
+	double **G;
+	double **RS;
+	double **P;
+	double **P_prev;
+	double **P_save;
+	uint8_t **Flag;
+	void *arena;		/* the one allocation of all fields */
+	size_t size;		/* its size in bytes */
+} fields;
+
+/**
+ * Allocates the fields of an imax x jmax grid, all set to zero. With hugepages the arena is
+ * aligned to 2 MB and the kernel is asked to back it with transparent huge pages, which saves
+ * TLB misses on the large grids (a warning is printed if that is not supported).
+ */
+void fields_init(fields *fl, int imax, int jmax, int hugepages);
+
+/**
+ * Releases the arena of fields_init().
+ */
+void fields_free(fields *fl);
+
 
 /**
  * reads in a ASCII pgm-file and returns the colour information in a two-dimensional integer array.
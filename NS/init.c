@@ -43,6 +43,19 @@
  * @param wl,wr,wt,wb boundary type
  * @param problem	 define problem to be solved
  * @param lp, rp, dp defines values of pressure at the left and right boundary, or the difference keeping right constant.
+ * @param solver	 pressure solver (0: SOR 1: red-black SOR 2: multigrid 3: PCG 5: Cholesky 6: line SOR)
+ * @param mg_gamma, mg_nu multigrid cycle (1: V 2: W) and number of smoothing sweeps
+ * @param precond	 PCG preconditioner (0: Jacobi 1: SSOR 2: incomplete Cholesky)
+ * @param fastpoisson direct cosine transform solver for domains without obstacles (0: off 1: on)
+ * @param rescheck	 check the residual of the SOR type solvers only every rescheck iterations
+ * @param extrapolate initial guess of the pressure extrapolated from the last two steps (0: off 1: on)
+ * @param omg_adapt	 tune omg of SOR and red-black SOR from the residual decay (0: off 1: on)
+ * @param eps_rel	 pressure tolerance relative to the norm of the right hand side (0: fixed eps)
+ * @param div_max	 bound of the RMS divergence of the velocities with the relative tolerance (0: none)
+ * @param fuse		 fused sweeps F/G/RS and U/V/velocity maxima (0: separate passes 1: fused)
+ * @param threads	 number of OpenMP threads (0: the OpenMP default, OMP_NUM_THREADS)
+ * @param hugepages	 back the field arena with transparent huge pages (0: off 1: on)
+ * @param sor_block	 SOR sweeps between residual checks run as one wavefront (1: single sweeps)
  * @param argv		 input argument for the problem
  * @param argc		 count there is only one input 
  */
@@ -76,6 +89,20 @@ int read_parameters(double *Re,                /* reynolds number   */
 		double *lp,					/* pressure at left boundary */
 		double *rp,					/* pressure at right boundary */
 		double *dp,					/* pressure difference */
+		int *solver,				/* pressure solver */
+		int *mg_gamma,				/* multigrid cycle */
+		int *mg_nu,				/* multigrid smoothing sweeps */
+		int *precond,				/* PCG preconditioner */
+		int *fastpoisson,			/* direct solver without obstacles */
+		int *rescheck,				/* iterations between residual checks */
+		int *extrapolate,			/* extrapolated initial pressure */
+		int *omg_adapt,				/* automatic relaxation factor */
+		double *eps_rel,			/* relative pressure tolerance */
+		double *div_max,			/* divergence bound */
+		int *fuse,				/* fused sweeps */
+		int *threads,				/* OpenMP threads */
+		int *hugepages,				/* huge pages for the fields */
+		int *sor_block,				/* SOR sweeps per wavefront */
 		int argc,
 		char *argv
 )           
@@ -120,6 +147,24 @@ int read_parameters(double *Re,                /* reynolds number   */
 		READ_DOUBLE ( szFileName, *rp );
 		READ_DOUBLE ( szFileName, *dp );
 
+		READ_INT( szFileName, *solver );
+		READ_INT( szFileName, *mg_gamma );
+		READ_INT( szFileName, *mg_nu );
+		READ_INT( szFileName, *precond );
+		READ_INT( szFileName, *fastpoisson );
+		READ_INT( szFileName, *rescheck );
+		if(*rescheck < 1){
+			*rescheck = 1;
+		}
+		READ_INT( szFileName, *extrapolate );
+		READ_INT( szFileName, *omg_adapt );
+		READ_DOUBLE( szFileName, *eps_rel );
+		READ_DOUBLE( szFileName, *div_max );
+		READ_INT( szFileName, *fuse );
+		READ_INT( szFileName, *threads );
+		READ_INT( szFileName, *hugepages );
+		READ_INT( szFileName, *sor_block );
+
 		*dx = *xlength / (double)(*imax);
 		*dy = *ylength / (double)(*jmax);
 
@@ -150,7 +195,7 @@ void init_uvp(
 		double **U,
 		double **V,
 		double **P,
-		int **Flag
+		uint8_t **Flag
 )
 
 {
@@ -194,7 +239,8 @@ void init_flag(
 		double lp,
 		double rp,
 		double dp,
-		int **Flag
+		uint8_t **Flag,
+		cell_lists *cells
 		){
 
 	char image[84];
@@ -208,7 +254,9 @@ void init_flag(
 
 	/* Outer boundaries will always be the same, so we assign those flags first*/
 	/* Corners: */
-	init_imatrix(Flag, 0, imax, 0, jmax, 0);
+	for(i = 0; i <= imax; i++){
+		memset(Flag[i], 0, (size_t)(jmax+1)*sizeof(uint8_t));
+	}
     
     
     /*Initialize corners*/
@@ -291,6 +339,113 @@ void init_flag(
 		}
 	}
 	free_imatrix(temp, 0, imax, 0, jmax);
+
+	build_cell_lists(imax, jmax, Flag, cells);
+}
+
+void build_cell_lists(int imax, int jmax, uint8_t **Flag, cell_lists *cells)
+{
+	static const int type_flag[CELL_TYPES] = {B_N, B_S, B_W, B_O, B_NO, B_NW, B_SO, B_SW};
+	const int ld = MATRIX_LD(Flag);
+	int i, j, k;
+
+	/* count the cells of every list first, then fill them in lexicographic order */
+	cells->nfluid = 0;
+	for(k = 0; k < CELL_TYPES; k++){
+		cells->nbnd[k] = 0;
+	}
+	for(i = 1; i <= imax; i++){
+		for(j = 1; j <= jmax; j++){
+			if((Flag[i][j]&B_C)==B_C){
+				cells->nfluid++;
+			}
+			else{
+				for(k = 0; k < CELL_TYPES; k++){
+					if((Flag[i][j]&31)==type_flag[k]){
+						cells->nbnd[k]++;
+					}
+				}
+			}
+		}
+	}
+
+	/* one extra entry, so that empty lists are valid allocations */
+	cells->fluid = (int*)malloc((size_t)(cells->nfluid + 1)*sizeof(int));
+	if(cells->fluid == NULL){
+		ERROR("Storage cannot be allocated");
+	}
+	for(k = 0; k < CELL_TYPES; k++){
+		cells->bnd[k] = (int*)malloc((size_t)(cells->nbnd[k] + 1)*sizeof(int));
+		if(cells->bnd[k] == NULL){
+			ERROR("Storage cannot be allocated");
+		}
+		cells->nbnd[k] = 0;
+	}
+	cells->nfluid = 0;
+	cells->ldm = (ld + 63)/64;
+	cells->fluid_mask = (uint64_t*)calloc((size_t)(imax+2)*cells->ldm, sizeof(uint64_t));
+	if(cells->fluid_mask == NULL){
+		ERROR("Storage cannot be allocated");
+	}
+
+	for(i = 1; i <= imax; i++){
+		for(j = 1; j <= jmax; j++){
+			if((Flag[i][j]&B_C)==B_C){
+				cells->fluid[cells->nfluid++] = mat_idx(i, j, ld);
+				cells->fluid_mask[i*cells->ldm + j/64] |= (uint64_t)1 << (j%64);
+			}
+			else{
+				for(k = 0; k < CELL_TYPES; k++){
+					if((Flag[i][j]&31)==type_flag[k]){
+						cells->bnd[k][cells->nbnd[k]++] = mat_idx(i, j, ld);
+					}
+				}
+			}
+		}
+	}
+
+	/* the fluid cells of every column as spans of consecutive cells (the outer boundary
+	 * cells j = 0 and j = jmax+1 are never fluid cells) */
+	cells->nspan = 0;
+	for(i = 1; i <= imax; i++){
+		for(j = 1; j <= jmax; j++){
+			if((Flag[i][j]&B_C)==B_C && (Flag[i][j-1]&B_C)!=B_C){
+				cells->nspan++;
+			}
+		}
+	}
+	cells->span_first = (int*)malloc((size_t)(imax+2)*sizeof(int));
+	cells->span = (int*)malloc((size_t)(2*cells->nspan + 1)*sizeof(int));
+	if(cells->span_first == NULL || cells->span == NULL){
+		ERROR("Storage cannot be allocated");
+	}
+	k = 0;
+	cells->span_first[0] = 0;
+	for(i = 1; i <= imax; i++){
+		cells->span_first[i] = k;
+		for(j = 1; j <= jmax; j++){
+			if((Flag[i][j]&B_C)==B_C && (Flag[i][j-1]&B_C)!=B_C){
+				cells->span[2*k] = mat_idx(i, j, ld);
+			}
+			if((Flag[i][j]&B_C)==B_C && (Flag[i][j+1]&B_C)!=B_C){
+				cells->span[2*k+1] = mat_idx(i, j+1, ld);
+				k++;
+			}
+		}
+	}
+	cells->span_first[imax+1] = k;
+}
+
+void free_cell_lists(cell_lists *cells)
+{
+	int k;
+	free(cells->fluid);
+	free(cells->fluid_mask);
+	free(cells->span_first);
+	free(cells->span);
+	for(k = 0; k < CELL_TYPES; k++){
+		free(cells->bnd[k]);
+	}
 }
 
 
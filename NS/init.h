@@ -37,6 +37,22 @@
  * @param eps        tolerance limit for pressure calculation
  * @param dt_value   time steps for output (after how many time steps one should
  *                   write into the output file)
+ * @param solver     pressure solver (0: SOR 1: red-black SOR 2: multigrid 3: PCG 5: Cholesky 6: line SOR)
+ * @param mg_gamma   multigrid cycle (1: V-cycle 2: W-cycle)
+ * @param mg_nu      number of multigrid pre- and post-smoothing sweeps
+ * @param precond    PCG preconditioner (0: Jacobi 1: SSOR 2: incomplete Cholesky)
+ * @param fastpoisson solve the pressure directly by a cosine transform if there are no obstacles
+ * @param rescheck   the residual of the iterative solvers is checked every rescheck iterations
+ * @param extrapolate start the pressure solve from the pressure extrapolated in time
+ * @param omg_adapt  estimate the optimal SOR relaxation factor at runtime (omg is the start value)
+ * @param eps_rel    tolerance of the pressure solve relative to the norm of RS, 0 for the fixed eps
+ * @param div_max    largest RMS divergence of the velocities accepted with eps_rel (0: no bound)
+ * @param fuse       compute F, G and RS in one sweep and the velocity maxima for the time step
+ *                   together with U and V (0: the separate passes)
+ * @param threads    number of OpenMP threads of the solver, 0 keeps the OpenMP default
+ * @param hugepages  ask for transparent huge pages for the arena of the fields (see fields_init())
+ * @param sor_block  largest number of SOR sweeps run together by sor_wavefront() between two
+ *                   residual checks (1: one sweep at a time)
  */
 int read_parameters( 
 		double *Re,
@@ -67,6 +83,20 @@ int read_parameters(
 		double *lp,
 		double *rp,
 		double *dp,
+		int *solver,
+		int *mg_gamma,
+		int *mg_nu,
+		int *precond,
+		int *fastpoisson,
+		int *rescheck,
+		int *extrapolate,
+		int *omg_adapt,
+		double *eps_rel,
+		double *div_max,
+		int *fuse,
+		int *threads,
+		int *hugepages,
+		int *sor_block,
 		int argc,
 		char *argv
 );
@@ -84,13 +114,14 @@ void init_uvp(
 		double **U,
 		double **V,
 		double **P,
-		int **Flag
+		uint8_t **Flag
 );
 
 /*The array Flag is initialized with the flags C_F for fluid cells and C_B for obstacle cells as
 specified by the parameter problem. This must be followed by a loop over all cells where
 the boundary cells are marked with the appropriate flags B_xy depending on the direction, in
-which neighboring fluid cells lie.*/
+which neighboring fluid cells lie. Finally the lists of the fluid cells and of the boundary
+cells of every type are built in cells.*/
 void init_flag(
 		const char *problem,
 		int imax,
@@ -98,7 +129,18 @@ void init_flag(
 		double lp,
 		double rp,
 		double dp,
-		int **Flag
+		uint8_t **Flag,
+		cell_lists *cells
 		);
+
+/**
+ * Builds the fluid and boundary cell lists from the flag field (called by init_flag()).
+ */
+void build_cell_lists(int imax, int jmax, uint8_t **Flag, cell_lists *cells);
+
+/**
+ * Frees the cell lists.
+ */
+void free_cell_lists(cell_lists *cells);
 #endif
 
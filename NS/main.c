@@ -4,7 +4,14 @@
 #include "boundary_val.h"
 #include "uvp.h"
 #include "sor.h"
+#include "multigrid.h"
+#include "pcg.h"
+#include "fastpoisson.h"
+#include "cholesky.h"
 #include <stdio.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /* CFD Lab - Worksheet 3 - Group 3
  * Camacho Barranco, Roberto
@@ -17,7 +24,7 @@
  * contains the main loop. So here are the individual steps of the algorithm:
  *
  * - read the program configuration file using read_parameters()
- * - set up the matrices (arrays) needed using the matrix() command
+ * - set up the fields (matrices) needed in one arena using fields_init()
  * - create the initial setup init_uvp(), init_flag(), output_uvp()
  * - perform the main loop
  * - trailer: destroy memory allocated and do some statistics
@@ -66,19 +73,62 @@ int main(int argc, char** argv){
 	int it;			/* SOR iteration counter*/
 	double res;		/* residual norm of the pressure equation*/
 	double eps;		/* accuracy criterion epsilon (tolerance) for pressure iteration (res < eps)*/
+	double eps_rel;		/* tolerance relative to the norm of RS (0: fixed tolerance eps)*/
+	double div_max;		/* bound of the divergence left by the pressure for eps_rel > 0*/
+	int fuse;		/* fused sweeps F/G/RS and U/V/velocity maxima (0: separate passes)*/
+	int threads;		/* OpenMP threads (0: OpenMP default)*/
+	int hugepages;		/* transparent huge pages for the fields*/
+	int sor_block;		/* SOR sweeps per wavefront pass*/
+	int nsweeps;		/* SOR sweeps of this wavefront pass*/
+	int have_max;		/* the velocity maxima of the last calculate_uv_max() are valid*/
+	double umax, vmax;	/* maximum absolute velocities for the next time step*/
+	double tol;		/* tolerance of the pressure solve in this time step*/
+	double div;		/* divergence left by the inexact pressure*/
+	double div_peak;	/* largest RMS divergence of all time steps*/
+	double div_cell;	/* largest divergence of a cell in all time steps*/
+	int capped;		/* time steps with the tolerance bounded by div_max*/
+	int iterations;		/* pressure iterations of all time steps*/
 	double omg;		/* relaxation factor omega for SOR iteration*/
+	int solver;		/* pressure solver (SOLVER_... in helper.h)*/
+	int rescheck;		/* the residual is checked every rescheck iterations*/
+	int check;		/* the residual is checked in this iteration*/
+	int extrapolate;	/* start the pressure solve from the extrapolated pressure*/
+	double dt_old;		/* time step size of the previous step*/
+	double res_old;		/* residual of the last pressure at the start of the solve*/
+	double res_new;		/* residual of the extrapolated pressure*/
+	int ext_step;		/* this step starts from the extrapolated pressure*/
+	int ext_skip;		/* steps without extrapolation after it did not pay off*/
+	int ext_backoff;	/* length of the next pause of the extrapolation*/
+	int converged;		/* number of consecutive converged pressure solves*/
+	int it_last;		/* pressure iterations of the previous step*/
+	int ext_steps[2];	/* steps with two converged predecessors started from the last/extrapolated pressure*/
+	int ext_iters[2];	/* pressure iterations of these steps*/
+	int omg_adapt;		/* tune omg from the residual decay*/
+	omg_tuner ot;		/* estimate of the optimal omg*/
+	int mg_gamma;		/* multigrid cycle (1: V-cycle 2: W-cycle)*/
+	int mg_nu;		/* multigrid pre- and post-smoothing sweeps*/
+	multigrid mg;		/* multigrid hierarchy*/
+	int precond;		/* preconditioner of the PCG solver*/
+	pcg cg;			/* PCG solver*/
+	int fastpoisson;	/* use the direct solver if there are no obstacles*/
+	fastpoisson_solver fp;	/* direct cosine transform solver*/
+	cholesky ch;		/* factorized pressure operator*/
 	double alpha;		/* upwind differencing factor alpha (see equation (4))*/
 	/* Problem-dependent quantities:*/
 	double Re;		/* Reynolds number Re*/
 	double GX,GY;		/* external forces gx; gy, e.g. gravity*/
 	double UI,VI,PI;	/* initial data for velocities and pressure*/
 	/* Arrays*/
+	fields fl;			/* arena of all fields below*/
 	double **U;			/* velocity in x-direction*/
 	double **V;			/* velocity in y-direction*/
 	double **P;			/* pressure*/
+	double **P_prev, **P_save;	/* pressure of the previous steps for the extrapolation*/
+	double **swap;
 	double **RS;		/* right-hand side for pressure iteration*/
 	double **F,**G;		/* F;G*/
-	int **Flag; 		/* Flag field used to classify fluid cells*/
+	uint8_t **Flag; 		/* Flag field used to classify fluid cells*/
+	cell_lists cells;	/* fluid and boundary cell lists built from Flag */
 	/*Boundary values*/
 	int wl;				/* boundary type for left wall (1:no-slip 2: free-slip 3: outflow) */
 	int wr;				/* boundary type for right wall (1:no-slip 2: free-slip 3: outflow) */
@@ -87,30 +137,77 @@ int main(int argc, char** argv){
 	double lp;			/* pressure in left boundary */
 	double rp;			/* pressure in right boundary */
 	double dp;          /* change in pressure with right boundary = 0 */
+	boundary_set bc;	/* wall handlers and inflow profiles of the scenario */
 	char problem[80];
 	int n_div;
 
 	/* read the program configuration file using read_parameters()*/
 	read_parameters(&Re, &UI, &VI, &PI, &GX, &GY, &t_end, &xlength, &ylength, &dt, &dx, &dy, &imax,
 			&jmax, &alpha, &omg, &tau, &itermax, &eps, &dt_value, &wl, &wr, &wt, &wb, problem, &lp, &rp, &dp,
-			argc, argv[1]);
+			&solver, &mg_gamma, &mg_nu, &precond, &fastpoisson, &rescheck, &extrapolate, &omg_adapt, &eps_rel, &div_max, &fuse, &threads, &hugepages, &sor_block, argc, argv[1]);
+#ifdef _OPENMP
+	if(threads > 0){
+		omp_set_num_threads(threads);
+	}
+	printf("Running with %i OpenMP threads\n", omp_get_max_threads());
+#endif
 
-	/* set up the matrices (arrays) needed using the matrix() command*/
-	U = matrix(0, imax+1, 0, jmax+1);
-	V = matrix(0, imax+1, 0, jmax+1);
-	P = matrix(0, imax+1, 0, jmax+1);
-	RS = matrix(0, imax+1, 0, jmax+1);
-	F = matrix(0, imax+1, 0, jmax+1);
-	G = matrix(0, imax+1, 0, jmax+1);
-	Flag = imatrix(0, imax+1, 0, jmax+1);
+	/* set up the matrices (arrays) needed in one arena*/
+	fields_init(&fl, imax, jmax, hugepages);
+	U = fl.U;
+	V = fl.V;
+	P = fl.P;
+	RS = fl.RS;
+	F = fl.F;
+	G = fl.G;
+	P_prev = fl.P_prev;
+	P_save = fl.P_save;
+	Flag = fl.Flag;
 
 	/* initialize current time and time step*/
 	t = 0;
 	n = 0;
+	dt_old = dt;
+	converged = 0;
+	ext_skip = 0;
+	ext_backoff = 1;
+	it_last = 0;
+	ext_steps[0] = ext_steps[1] = 0;
+	ext_iters[0] = ext_iters[1] = 0;
+	omg_tune_init(&ot, omg);
+	div_peak = 0.0;
+	div_cell = 0.0;
+	capped = 0;
+	iterations = 0;
+	have_max = 0;
+	umax = vmax = 0.0;
 
 	/* create the initial setup init_uvp()*/
-	init_flag(problem, imax, jmax, lp, rp, dp, Flag);
+	init_flag(problem, imax, jmax, lp, rp, dp, Flag, &cells);
+	boundary_init(&bc, problem, imax, jmax, wl, wr, wt, wb);
 	init_uvp(UI, VI, PI, imax, jmax, U, V, P, Flag);
+	/* without obstacles the pressure equation is solved directly */
+	if(fastpoisson && obstacle_free(imax, jmax, Flag)){
+		if(solver != SOLVER_DCT){
+			printf("fastpoisson is set: the direct solver is used instead of solver %i of the parameter file\n", solver);
+		}
+		solver = SOLVER_DCT;
+		fp_init(&fp, imax, jmax, dx, dy, Flag);
+	}
+	else if(solver == SOLVER_MULTIGRID){
+		mg_init(&mg, imax, jmax, dx, dy, mg_gamma, mg_nu, Flag);
+	}
+	else if(solver == SOLVER_PCG){
+		pcg_init(&cg, imax, jmax, dx, dy, precond, omg, Flag);
+	}
+	else if(solver == SOLVER_CHOLESKY){
+		chol_init(&ch, imax, jmax, dx, dy, Flag);
+	}
+	/* the direct solvers do not need a start value */
+	if(extrapolate && (solver == SOLVER_DCT || solver == SOLVER_CHOLESKY)){
+		printf("extrapolate is set: no effect with the direct solver, the pressure history is not kept\n");
+		extrapolate = 0;
+	}
 
 	/* ----------------------------------------------------------------------- */
 	/*                             Performing the main loop                    */
@@ -118,29 +215,159 @@ int main(int argc, char** argv){
 
 	/* Upperbound t_end+dt/10 to be sure that it runs for t=t_end */
 	while (t<t_end){
-		/*	Select dt*/
-		calculate_dt(Re, tau, &dt, dx, dy, imax, jmax, U, V, Flag);
+		/*	Select dt (from the maxima of the last fused velocity update)*/
+		if(fuse && have_max){
+			select_dt(Re, tau, &dt, dx, dy, umax, vmax);
+		}
+		else{
+			calculate_dt(Re, tau, &dt, dx, dy, imax, jmax, U, V, &cells);
+		}
 		/*	Set boundary values for u and v according to (14),(15)*/
-		boundaryvalues(imax, jmax, U, V, wl, wr, wt, wb, Flag);
+		boundaryvalues(imax, jmax, U, V, &bc, &cells);
 		/*  Set special boundary values according to the problem*/
-		spec_boundary_val(problem, imax, jmax, U, V);
-		/*	Compute F(n) and G(n) according to (9),(10),(17)*/
-		calculate_fg(Re, GX, GY, alpha, dt, dx, dy, imax, jmax, U, V ,F , G, Flag);
-		/*	Compute the right-hand side rs of the pressure equation (11)*/
-		calculate_rs(dt, dx, dy, imax, jmax, F, G, RS);
+		spec_boundary_val(imax, jmax, U, V, &bc);
+		/*	Compute F(n) and G(n) according to (9),(10),(17) and the*/
+		/*	right-hand side rs of the pressure equation (11)*/
+		if(fuse){
+			calculate_fg_rs(Re, GX, GY, alpha, dt, dx, dy, imax, jmax, U, V, F, G, RS, &cells);
+		}
+		else{
+			calculate_fg(Re, GX, GY, alpha, dt, dx, dy, imax, jmax, U, V ,F , G, &cells);
+			calculate_rs(dt, dx, dy, imax, jmax, F, G, RS);
+		}
 		/*	Set it := 0*/
 		res = 1.0;
 		it = 0;
-		/*	While it < itmax and res > eps*/
-		while(it < itermax && res > eps){
+		/*	Start from the pressure extrapolated from the last two steps if*/
+		/*	both were converged (only for the iterative solvers). The initial*/
+		/*	residual is known then, a converged start needs no iteration*/
+		ext_step = 0;
+		if(extrapolate){
+			ext_step = extrapolate_pressure(ext_skip > 0 ? 0 : converged, dt/dt_old, dx, dy, imax, jmax,
+					P, P_prev, P_save, RS, &res_old, &res_new, lp, rp, dp, Flag);
+			if(converged >= 2 && ext_skip == 0){
+				res = res_new;
+			}
+			if(ext_skip > 0){
+				ext_skip--;
+			}
+		}
+		/*	Inexact projection: the tolerance follows the norm of RS, which*/
+		/*	is small on the easy steps, and is bounded by div_max/dt, since*/
+		/*	dt times the residual is the divergence of the new velocities*/
+		/*	(both in the RMS norm of calculate_res())*/
+		tol = eps;
+		if(eps_rel > 0.0){
+			tol = eps_rel*rs_norm(imax, jmax, RS, Flag);
+			if(div_max > 0.0 && tol > div_max/dt){
+				tol = div_max/dt;
+				capped++;
+			}
+		}
+		/*	The conjugate gradient solver iterates on its own*/
+		if(solver == SOLVER_PCG){
+			it += pcg_solve(&cg, dx, dy, imax, jmax, P, RS, tol, itermax-it, &res, lp, rp, dp, Flag);
+			printf("Time step %i: %i PCG iterations, residual %e\n", n, it, res);
+		}
+		else if(solver == SOLVER_DCT){
+			fp_solve(&fp, dx, dy, imax, jmax, P, RS, &res, lp, rp, dp, Flag);
+			it = 1;
+		}
+		else if(solver == SOLVER_CHOLESKY){
+			it = chol_solve(&ch, dx, dy, imax, jmax, P, RS, tol, &res, lp, rp, dp, Flag);
+			if(res > tol){
+				printf("Time step %i: Cholesky solve not converged after %i solves, residual %e\n", n, it, res);
+			}
+		}
+		/*	While it < itmax and res > tol*/
+		while(solver != SOLVER_PCG && solver != SOLVER_DCT && solver != SOLVER_CHOLESKY &&
+				it < itermax && res > tol){
 			/*	Perform a SOR iteration according to (18) using the*/
-			/*	provided function and retrieve the residual res*/
-			sor(omg, dx, dy, imax, jmax, P, RS, &res, lp, rp, dp, Flag);
+			/*	provided function and retrieve the residual res, which*/
+			/*	is only computed every rescheck iterations*/
+			check = ((it+1) % rescheck == 0 || it+1 == itermax);
+			if(solver == SOLVER_REDBLACK){
+				sor_redblack(omg, dx, dy, imax, jmax, P, RS, check ? &res : NULL, lp, rp, dp, Flag, &cells);
+			}
+			else if(solver == SOLVER_LINE){
+				sor_line(omg, dx, dy, imax, jmax, P, RS, check ? &res : NULL, lp, rp, dp, Flag, &cells);
+			}
+			else if(solver == SOLVER_MULTIGRID){
+				mg_cycle(&mg, dx, dy, imax, jmax, P, RS, &res, lp, rp, dp, Flag);
+			}
+			else{
+				/*	The sweeps up to the next residual check (at most*/
+				/*	sor_block) run in one wavefront pass, which gives*/
+				/*	the same result as the single sweeps*/
+				nsweeps = min(min(rescheck - it % rescheck, itermax - it), sor_block);
+				if(nsweeps > 1){
+					check = ((it+nsweeps) % rescheck == 0 || it+nsweeps == itermax);
+					sor_wavefront(omg, dx, dy, imax, jmax, P, RS, nsweeps, check ? &res : NULL, lp, rp, dp, Flag, &cells);
+					it += nsweeps - 1;
+				}
+				else{
+					sor(omg, dx, dy, imax, jmax, P, RS, check ? &res : NULL, lp, rp, dp, Flag, &cells);
+				}
+			}
 			/*	it := it + 1*/
 			it++;
+			if(omg_adapt && check){
+				omg_tune_check(&ot, it, res);
+			}
+		}
+		/*	dt times the residual is the divergence of the new velocities,*/
+		/*	tol keeps its RMS norm below div_max. The largest value of a*/
+		/*	single cell is only reported*/
+		if(eps_rel > 0.0){
+			div = dt*res;
+			if(div > div_peak){
+				div_peak = div;
+			}
+			div = dt*max_res(dx, dy, imax, jmax, P, RS, Flag);
+			if(div > div_cell){
+				div_cell = div;
+			}
 		}
+		/*	The tuner chooses omg of the next solve (spectral radius*/
+		/*	from the first solves, then a search on the iterations)*/
+		if(omg_adapt && (solver == SOLVER_SOR || solver == SOLVER_REDBLACK)){
+			omg = omg_tune_update(&ot, n, omg, it);
+		}
+		if(solver == SOLVER_MULTIGRID){
+			printf("Time step %i: %i multigrid cycles, residual %e\n", n, it, res);
+		}
+		if(extrapolate){
+			/*	The smaller residual of the extrapolation does not guarantee*/
+			/*	fewer iterations (the smooth error of the loosely converged*/
+			/*	fields is extrapolated too). If it took more iterations than*/
+			/*	the last step, pause it for a doubling number of steps*/
+			if(converged >= 2){
+				ext_steps[ext_step]++;
+				ext_iters[ext_step] += it;
+			}
+			if(ext_step && it > it_last){
+				ext_skip = ext_backoff;
+				ext_backoff = (ext_backoff < 64) ? 2*ext_backoff : 64;
+			}
+			else if(ext_step){
+				ext_backoff = 1;
+			}
+			swap = P_prev;
+			P_prev = P_save;
+			P_save = swap;
+		}
+		converged = (res <= tol) ? converged+1 : 0;
+		it_last = it;
+		dt_old = dt;
+		iterations += it;
 		/*	Compute u(n+1) and v(n+1) according to (7),(8)*/
-		calculate_uv(dt, dx, dy, imax, jmax, U, V, F, G, P, Flag);
+		if(fuse){
+			calculate_uv_max(dt, dx, dy, imax, jmax, U, V, F, G, P, &cells, &umax, &vmax);
+			have_max = 1;
+		}
+		else{
+			calculate_uv(dt, dx, dy, imax, jmax, U, V, F, G, P, &cells);
+		}
 		/*	Output of u; v; p values for visualization, if necessary*/
 
 		n_div=(int)(dt_value/dt);
@@ -154,14 +381,41 @@ int main(int argc, char** argv){
 
 	}
 
-	/* Destroy memory allocated*/
-	free_matrix(U, 0, imax+1, 0, jmax+1);
-	free_matrix(V, 0, imax+1, 0, jmax+1);
-	free_matrix(P, 0, imax+1, 0, jmax+1);
+	if(extrapolate){
+		/* the saving is estimated from the mean iterations of the steps started from the last pressure */
+		printf("Pressure extrapolation used in %i of %i time steps, %.1f iterations per step (%.1f without, %i steps)\n",
+				ext_steps[1], n, ext_steps[1] > 0 ? (double)ext_iters[1]/ext_steps[1] : 0.0,
+				ext_steps[0] > 0 ? (double)ext_iters[0]/ext_steps[0] : 0.0, ext_steps[0]);
+		if(ext_steps[0] > 0 && ext_steps[1] > 0){
+			printf("About %.0f pressure iterations saved\n",
+					ext_steps[1]*((double)ext_iters[0]/ext_steps[0] - (double)ext_iters[1]/ext_steps[1]));
+		}
+	}
 
-	free_matrix(RS, 0, imax+1, 0, jmax+1);
-	free_matrix(F, 0, imax+1, 0, jmax+1);
-	free_matrix(G, 0, imax+1, 0, jmax+1);
-	free_imatrix(Flag, 0, imax+1, 0, jmax+1);
+	if(omg_adapt && (solver == SOLVER_SOR || solver == SOLVER_REDBLACK)){
+		omg_tune_report(&ot);
+	}
+	if(eps_rel > 0.0){
+		printf("Inexact projection: %i pressure iterations, tolerance bounded by div_max in %i of %i time steps\n",
+				iterations, capped, n);
+		printf("Largest divergence left by the pressure %e (RMS), %e (cell)\n", div_peak, div_cell);
+	}
+
+	/* Destroy memory allocated*/
+	fields_free(&fl);
+	free_cell_lists(&cells);
+	boundary_free(&bc);
+	if(solver == SOLVER_MULTIGRID){
+		mg_free(&mg, imax, jmax);
+	}
+	else if(solver == SOLVER_PCG){
+		pcg_free(&cg, imax, jmax);
+	}
+	else if(solver == SOLVER_DCT){
+		fp_free(&fp, imax, jmax);
+	}
+	else if(solver == SOLVER_CHOLESKY){
+		chol_free(&ch, imax, jmax);
+	}
 	return -1;
 }
@@ -0,0 +1,318 @@
+#include "multigrid.h"
+#include "sor.h"
+#include "helper.h"
+#include <math.h>
+
+/* number of Gauss-Seidel sweeps on the coarsest grid */
+#define MG_COARSE_SWEEPS 50
+
+/*
+ * Gauss-Seidel sweeps for the error equation A e = r of a coarse level. A neighbour that is
+ * not fluid is a homogeneous Neumann boundary (its error equals the error of the cell), the
+ * outer left/right boundary is a homogeneous Dirichlet boundary if a pressure is prescribed
+ * there (its error is the negative error of the cell).
+ */
+static void mg_smooth(const multigrid *mg, const mg_level *L, int sweeps)
+{
+	int i, j, s;
+	double rx = 1.0/(L->hx*L->hx);
+	double ry = 1.0/(L->hy*L->hy);
+	double sum, diag;
+
+	for(s = 0; s < sweeps; s++) {
+		for(i = 1; i <= L->imax; i++) {
+			for(j = 1; j <= L->jmax; j++) {
+				if(!L->fluid[i][j]) {
+					continue;
+				}
+				sum = 0.0;
+				diag = 0.0;
+				if(L->fluid[i-1][j]) { sum += rx*L->e[i-1][j]; diag += rx; }
+				else if(i == 1 && mg->left_dirichlet) { diag += 2.0*rx; }
+				if(L->fluid[i+1][j]) { sum += rx*L->e[i+1][j]; diag += rx; }
+				else if(i == L->imax && mg->right_dirichlet) { diag += 2.0*rx; }
+				if(L->fluid[i][j-1]) { sum += ry*L->e[i][j-1]; diag += ry; }
+				if(L->fluid[i][j+1]) { sum += ry*L->e[i][j+1]; diag += ry; }
+				if(diag > 0.0) {
+					L->e[i][j] = (sum - L->r[i][j])/diag;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Residual r - A e of a coarse level with the boundary treatment of mg_smooth().
+ */
+static void mg_residual(const multigrid *mg, const mg_level *L)
+{
+	int i, j;
+	double rx = 1.0/(L->hx*L->hx);
+	double ry = 1.0/(L->hy*L->hy);
+	double Ae;
+
+	for(i = 1; i <= L->imax; i++) {
+		for(j = 1; j <= L->jmax; j++) {
+			if(!L->fluid[i][j]) {
+				L->res[i][j] = 0.0;
+				continue;
+			}
+			Ae = 0.0;
+			if(L->fluid[i-1][j]) { Ae += rx*(L->e[i-1][j] - L->e[i][j]); }
+			else if(i == 1 && mg->left_dirichlet) { Ae -= 2.0*rx*L->e[i][j]; }
+			if(L->fluid[i+1][j]) { Ae += rx*(L->e[i+1][j] - L->e[i][j]); }
+			else if(i == L->imax && mg->right_dirichlet) { Ae -= 2.0*rx*L->e[i][j]; }
+			if(L->fluid[i][j-1]) { Ae += ry*(L->e[i][j-1] - L->e[i][j]); }
+			if(L->fluid[i][j+1]) { Ae += ry*(L->e[i][j+1] - L->e[i][j]); }
+			L->res[i][j] = L->r[i][j] - Ae;
+		}
+	}
+}
+
+/*
+ * Restricts the residual 'fine' of a grid with fluid cells 'fluid' to the right hand side of
+ * the coarse level C: every coarse cell gets the mean residual of its fine fluid cells. Without
+ * a Dirichlet boundary the problem is singular, so the mean of the coarse right hand side is
+ * removed to keep it consistent.
+ */
+static void mg_restrict(const multigrid *mg, double **fine, int **fluid, int imax, int jmax, mg_level *C)
+{
+	int I, J, i, j, n;
+	double sum, mean = 0.0;
+	int count = 0;
+
+	for(I = 1; I <= C->imax; I++) {
+		for(J = 1; J <= C->jmax; J++) {
+			sum = 0.0;
+			n = 0;
+			for(i = 2*I-1; i <= 2*I && i <= imax; i++) {
+				for(j = 2*J-1; j <= 2*J && j <= jmax; j++) {
+					if(fluid[i][j]) {
+						sum += fine[i][j];
+						n++;
+					}
+				}
+			}
+			C->r[I][J] = (n > 0) ? sum/n : 0.0;
+			C->e[I][J] = 0.0;
+			if(n > 0) {
+				mean += C->r[I][J];
+				count++;
+			}
+		}
+	}
+	if(!mg->left_dirichlet && !mg->right_dirichlet && count > 0) {
+		mean /= count;
+		for(I = 1; I <= C->imax; I++) {
+			for(J = 1; J <= C->jmax; J++) {
+				if(C->fluid[I][J]) {
+					C->r[I][J] -= mean;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Adds the coarse error of C (piecewise constant) to the fluid cells of the finer grid 'fine'.
+ */
+static void mg_prolongate(const mg_level *C, double **fine, int **fluid, int imax, int jmax)
+{
+	int i, j;
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if(fluid[i][j]) {
+				fine[i][j] += C->e[(i+1)/2][(j+1)/2];
+			}
+		}
+	}
+}
+
+/*
+ * Recursive cycle on coarse level l.
+ */
+static void mg_solve_level(multigrid *mg, int l)
+{
+	mg_level *L = &mg->level[l];
+	mg_level *C;
+	int k;
+
+	if(l == mg->nlevels-1) {
+		mg_smooth(mg, L, MG_COARSE_SWEEPS);
+		return;
+	}
+	C = &mg->level[l+1];
+	mg_smooth(mg, L, mg->nu);
+	mg_residual(mg, L);
+	mg_restrict(mg, L->res, L->fluid, L->imax, L->jmax, C);
+	for(k = 0; k < mg->gamma; k++) {
+		mg_solve_level(mg, l+1);
+	}
+	mg_prolongate(C, L->e, L->fluid, L->imax, L->jmax);
+	mg_smooth(mg, L, mg->nu);
+}
+
+/*
+ * Gauss-Seidel sweeps for the pressure itself on the fine grid. The obstacle and outer
+ * boundary values are updated after every sweep, as in sor().
+ */
+static void mg_smooth_fine(
+		int sweeps, double dx, double dy, int imax, int jmax, double **P, double **RS,
+		double lp, double rp, double dp, uint8_t **Flag)
+{
+	int i, j, s;
+	double coeff = 1.0/(2.0*(1.0/(dx*dx)+1.0/(dy*dy)));
+
+	for(s = 0; s < sweeps; s++) {
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				if((Flag[i][j]&B_C)==B_C) {
+					P[i][j] = coeff*(( P[i+1][j]+P[i-1][j])/(dx*dx) +
+							( P[i][j+1]+P[i][j-1])/(dy*dy) - RS[i][j]);
+				}
+			}
+		}
+		set_obstacle_pressure(imax, jmax, P, Flag);
+		set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+	}
+}
+
+void mg_init(
+		multigrid *mg,
+		int imax,
+		int jmax,
+		double dx,
+		double dy,
+		int gamma,
+		int nu,
+		uint8_t **Flag
+){
+	int l, i, j, I, J;
+	int ni = imax, nj = jmax;
+	mg_level *L;
+
+	mg->gamma = gamma;
+	mg->nu = nu;
+	/* P_L and P_R are set for the whole left/right column, see init_flag() */
+	mg->left_dirichlet = (Flag[0][1]&P_L)==P_L;
+	mg->right_dirichlet = (Flag[imax+1][1]&P_R)==P_R;
+	mg->R0 = matrix(0, imax+1, 0, jmax+1);
+	init_matrix(mg->R0, 0, imax+1, 0, jmax+1, 0.0);
+
+	/* count the coarse levels: coarsen as long as both directions keep at least two cells */
+	mg->nlevels = 1;
+	while((ni+1)/2 >= 2 && (nj+1)/2 >= 2) {
+		ni = (ni+1)/2;
+		nj = (nj+1)/2;
+		mg->nlevels++;
+	}
+	mg->level = (mg_level *) malloc((size_t)(mg->nlevels*sizeof(mg_level)));
+	if(mg->level == NULL) ERROR("Storage cannot be allocated");
+
+	/* level 0 describes the fine grid, its fluid flags are 0/1 copies of Flag */
+	mg->level[0].imax = imax;
+	mg->level[0].jmax = jmax;
+	mg->level[0].hx = dx;
+	mg->level[0].hy = dy;
+	mg->level[0].e = NULL;
+	mg->level[0].r = NULL;
+	mg->level[0].res = NULL;
+	mg->level[0].fluid = imatrix(0, imax+1, 0, jmax+1);
+	for(i = 0; i <= imax+1; i++) {
+		for(j = 0; j <= jmax+1; j++) {
+			mg->level[0].fluid[i][j] = (i > 0 && i <= imax && j > 0 && j <= jmax && (Flag[i][j]&B_C)==B_C);
+		}
+	}
+
+	for(l = 1; l < mg->nlevels; l++) {
+		L = &mg->level[l];
+		L->imax = (mg->level[l-1].imax+1)/2;
+		L->jmax = (mg->level[l-1].jmax+1)/2;
+		L->hx = 2.0*mg->level[l-1].hx;
+		L->hy = 2.0*mg->level[l-1].hy;
+		L->e = matrix(0, L->imax+1, 0, L->jmax+1);
+		L->r = matrix(0, L->imax+1, 0, L->jmax+1);
+		L->res = matrix(0, L->imax+1, 0, L->jmax+1);
+		L->fluid = imatrix(0, L->imax+1, 0, L->jmax+1);
+		init_matrix(L->e, 0, L->imax+1, 0, L->jmax+1, 0.0);
+		init_matrix(L->r, 0, L->imax+1, 0, L->jmax+1, 0.0);
+		init_matrix(L->res, 0, L->imax+1, 0, L->jmax+1, 0.0);
+		init_imatrix(L->fluid, 0, L->imax+1, 0, L->jmax+1, 0);
+		for(I = 1; I <= L->imax; I++) {
+			for(J = 1; J <= L->jmax; J++) {
+				for(i = 2*I-1; i <= 2*I && i <= mg->level[l-1].imax; i++) {
+					for(j = 2*J-1; j <= 2*J && j <= mg->level[l-1].jmax; j++) {
+						L->fluid[I][J] |= mg->level[l-1].fluid[i][j];
+					}
+				}
+			}
+		}
+	}
+	printf("Multigrid: %i levels, coarsest grid %i x %i, %s-cycle\n", mg->nlevels,
+			mg->level[mg->nlevels-1].imax, mg->level[mg->nlevels-1].jmax, gamma == 1 ? "V" : "W");
+}
+
+void mg_cycle(
+		multigrid *mg,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag
+){
+	int i, j, k;
+	double rdx2 = 1.0/(dx*dx);
+	double rdy2 = 1.0/(dy*dy);
+
+	/* make sure the boundary values belong to the current P before the first sweep */
+	set_obstacle_pressure(imax, jmax, P, Flag);
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+
+	mg_smooth_fine(mg->nu, dx, dy, imax, jmax, P, RS, lp, rp, dp, Flag);
+
+	if(mg->nlevels > 1) {
+		/* fine residual RS - A P */
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				if((Flag[i][j]&B_C)==B_C) {
+					mg->R0[i][j] = RS[i][j] - ((P[i+1][j]-2.0*P[i][j]+P[i-1][j])*rdx2 +
+							(P[i][j+1]-2.0*P[i][j]+P[i][j-1])*rdy2);
+				}
+			}
+		}
+		mg_restrict(mg, mg->R0, mg->level[0].fluid, imax, jmax, &mg->level[1]);
+		for(k = 0; k < mg->gamma; k++) {
+			mg_solve_level(mg, 1);
+		}
+		mg_prolongate(&mg->level[1], P, mg->level[0].fluid, imax, jmax);
+		set_obstacle_pressure(imax, jmax, P, Flag);
+		set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+	}
+
+	mg_smooth_fine(mg->nu, dx, dy, imax, jmax, P, RS, lp, rp, dp, Flag);
+
+	*res = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+}
+
+void mg_free(multigrid *mg, int imax, int jmax)
+{
+	int l;
+	mg_level *L;
+
+	for(l = 1; l < mg->nlevels; l++) {
+		L = &mg->level[l];
+		free_matrix(L->e, 0, L->imax+1, 0, L->jmax+1);
+		free_matrix(L->r, 0, L->imax+1, 0, L->jmax+1);
+		free_matrix(L->res, 0, L->imax+1, 0, L->jmax+1);
+		free_imatrix(L->fluid, 0, L->imax+1, 0, L->jmax+1);
+	}
+	free_imatrix(mg->level[0].fluid, 0, imax+1, 0, jmax+1);
+	free_matrix(mg->R0, 0, imax+1, 0, jmax+1);
+	free(mg->level);
+}
@@ -0,0 +1,78 @@
+#ifndef __MULTIGRID_H_
+#define __MULTIGRID_H_
+
+#include "helper.h"
+
+/**
+ * One coarse level of the multigrid hierarchy. The coarse levels solve the error equation
+ * A e = r, the level keeps the error e, its right hand side r, the residual of the level
+ * and a flag field telling which coarse cells contain fluid.
+ */
+typedef struct {
+  int imax;
+  int jmax;
+  double hx;
+  double hy;
+  double **e;
+  double **r;
+  double **res;
+  int **fluid;
+} mg_level;
+
+/**
+ * Multigrid hierarchy for the pressure Poisson equation. Level 0 is the pressure P itself,
+ * level[1..nlevels-1] are the coarse grids.
+ */
+typedef struct {
+  int nlevels;
+  mg_level *level;
+  int gamma;            /* 1: V-cycle 2: W-cycle */
+  int nu;               /* number of pre- and post-smoothing sweeps */
+  int left_dirichlet;   /* P_L: the left boundary has a prescribed pressure */
+  int right_dirichlet;  /* P_R: the right boundary has a prescribed pressure */
+  double **R0;          /* residual on the fine grid */
+} multigrid;
+
+/**
+ * Builds the multigrid hierarchy. The grids are coarsened by a factor of two in each
+ * direction, a coarse cell contains fluid if one of its four fine cells is a fluid cell
+ * according to Flag. Obstacles and walls are homogeneous Neumann boundaries for the error,
+ * the boundaries with P_L/P_R are Dirichlet boundaries.
+ */
+void mg_init(
+  multigrid *mg,
+  int imax,
+  int jmax,
+  double dx,
+  double dy,
+  int gamma,
+  int nu,
+  uint8_t **Flag
+);
+
+/**
+ * One multigrid cycle (V-cycle for gamma = 1, W-cycle for gamma = 2) for the pressure
+ * equation with the same interface as sor(): P is updated including the boundary values and
+ * the residual is stored in res.
+ */
+void mg_cycle(
+  multigrid *mg,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag
+);
+
+/**
+ * Frees the coarse grids.
+ */
+void mg_free(multigrid *mg, int imax, int jmax);
+
+#endif
@@ -0,0 +1,342 @@
+#include "pcg.h"
+#include "sor.h"
+#include "helper.h"
+#include <math.h>
+
+/*
+ * Scalar product of two fields over the fluid cells.
+ */
+static double dot(const pcg *cg, int imax, int jmax, double **a, double **b)
+{
+	int i, j;
+	double sum = 0.0;
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if(cg->fluid[i][j]) {
+				sum += a[i][j]*b[i][j];
+			}
+		}
+	}
+	return sum;
+}
+
+/*
+ * y = -A x for the homogeneous problem: the negative Laplacian with Neumann faces to
+ * obstacles and walls and Dirichlet faces to P_L/P_R boundaries (their weight is in diag),
+ * and the diagonal couplings through the corner cells.
+ */
+static void apply_operator(const pcg *cg, double dx, double dy, int imax, int jmax, double **x, double **y)
+{
+	int i, j;
+	double cx = 1.0/(dx*dx);
+	double cy = 1.0/(dy*dy);
+	double sum;
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if(!cg->fluid[i][j]) {
+				continue;
+			}
+			sum = cg->diag[i][j]*x[i][j];
+			if(cg->fluid[i-1][j]) sum -= cx*x[i-1][j];
+			if(cg->fluid[i+1][j]) sum -= cx*x[i+1][j];
+			if(cg->fluid[i][j-1]) sum -= cy*x[i][j-1];
+			if(cg->fluid[i][j+1]) sum -= cy*x[i][j+1];
+			sum -= cg->cnw[i][j]*x[i-1][j+1] + cg->csw[i][j]*x[i-1][j-1] +
+					cg->cnw[i+1][j-1]*x[i+1][j-1] + cg->csw[i+1][j+1]*x[i+1][j+1];
+			y[i][j] = sum;
+		}
+	}
+}
+
+/*
+ * z = M^-1 r. Jacobi divides by the diagonal. SSOR and incomplete Cholesky share the form
+ * M = (D - L) D^-1 (D - U) with the strictly lower/upper couplings L, U of the lexicographic
+ * order (the corner couplings included) and the pivots D (diag/omg for SSOR, the IC(0) pivots otherwise), so both are applied
+ * by one forward and one backward substitution. The constant factor of SSOR is left out, it
+ * does not change the CG iterates.
+ */
+static void apply_preconditioner(const pcg *cg, double dx, double dy, int imax, int jmax, double **r, double **z)
+{
+	int i, j;
+	double cx = 1.0/(dx*dx);
+	double cy = 1.0/(dy*dy);
+	double sum;
+
+	if(cg->precond == PRECOND_JACOBI) {
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				if(cg->fluid[i][j]) {
+					z[i][j] = r[i][j]/cg->diag[i][j];
+				}
+			}
+		}
+		return;
+	}
+
+	/* forward substitution (D - L) y = r */
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if(!cg->fluid[i][j]) {
+				continue;
+			}
+			sum = r[i][j];
+			if(cg->fluid[i-1][j]) sum += cx*z[i-1][j];
+			if(cg->fluid[i][j-1]) sum += cy*z[i][j-1];
+			sum += cg->cnw[i][j]*z[i-1][j+1] + cg->csw[i][j]*z[i-1][j-1];
+			z[i][j] = sum/cg->pivot[i][j];
+		}
+	}
+	/* backward substitution (D - U) z = D y */
+	for(i = imax; i >= 1; i--) {
+		for(j = jmax; j >= 1; j--) {
+			if(!cg->fluid[i][j]) {
+				continue;
+			}
+			sum = 0.0;
+			if(cg->fluid[i+1][j]) sum += cx*z[i+1][j];
+			if(cg->fluid[i][j+1]) sum += cy*z[i][j+1];
+			sum += cg->cnw[i+1][j-1]*z[i+1][j-1] + cg->csw[i+1][j+1]*z[i+1][j+1];
+			z[i][j] += sum/cg->pivot[i][j];
+		}
+	}
+}
+
+void pcg_init(
+		pcg *cg,
+		int imax,
+		int jmax,
+		double dx,
+		double dy,
+		int precond,
+		double omg,
+		uint8_t **Flag
+){
+	int i, j, ncorner = 0;
+	double cx = 1.0/(dx*dx);
+	double cy = 1.0/(dy*dy);
+	/* A corner cell with the mean of its fluid neighbours a (in y) and b (in x) adds
+	 * cy (pa-pb)/2 to the equation of a and cx (pb-pa)/2 to that of b. */
+	double w = 0.25*(cx+cy);
+	static const char *names[] = {"Jacobi", "SSOR", "incomplete Cholesky"};
+
+	if(precond < PRECOND_JACOBI || precond > PRECOND_IC) {
+		ERROR("Unknown preconditioner");
+	}
+	cg->precond = precond;
+	cg->omg = omg;
+	/* P_L and P_R are set for the whole left/right column, see init_flag() */
+	cg->left_dirichlet = (Flag[0][1]&P_L)==P_L;
+	cg->right_dirichlet = (Flag[imax+1][1]&P_R)==P_R;
+
+	cg->fluid = imatrix(0, imax+1, 0, jmax+1);
+	cg->diag = matrix(0, imax+1, 0, jmax+1);
+	cg->cnw = matrix(0, imax+1, 0, jmax+1);
+	cg->csw = matrix(0, imax+1, 0, jmax+1);
+	cg->pivot = matrix(0, imax+1, 0, jmax+1);
+	cg->r = matrix(0, imax+1, 0, jmax+1);
+	cg->z = matrix(0, imax+1, 0, jmax+1);
+	cg->p = matrix(0, imax+1, 0, jmax+1);
+	cg->q = matrix(0, imax+1, 0, jmax+1);
+	init_matrix(cg->diag, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->cnw, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->csw, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->pivot, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->r, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->z, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->p, 0, imax+1, 0, jmax+1, 0.0);
+	init_matrix(cg->q, 0, imax+1, 0, jmax+1, 0.0);
+
+	cg->nfluid = 0;
+	for(i = 0; i <= imax+1; i++) {
+		for(j = 0; j <= jmax+1; j++) {
+			cg->fluid[i][j] = (i > 0 && i <= imax && j > 0 && j <= jmax && (Flag[i][j]&B_C)==B_C);
+			cg->nfluid += cg->fluid[i][j];
+		}
+	}
+
+	/* the corner cells couple their two fluid neighbours diagonally */
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			switch(Flag[i][j]&31) {
+			case B_NO:
+				cg->cnw[i+1][j] += w;
+				break;
+			case B_NW:
+				cg->csw[i][j+1] += w;
+				break;
+			case B_SO:
+				cg->csw[i+1][j] += w;
+				break;
+			case B_SW:
+				cg->cnw[i][j-1] += w;
+				break;
+			default:
+				continue;
+			}
+			ncorner++;
+		}
+	}
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if(!cg->fluid[i][j]) {
+				continue;
+			}
+			if(cg->fluid[i-1][j]) cg->diag[i][j] += cx;
+			else if(i == 1 && cg->left_dirichlet) cg->diag[i][j] += 2.0*cx;
+			if(cg->fluid[i+1][j]) cg->diag[i][j] += cx;
+			else if(i == imax && cg->right_dirichlet) cg->diag[i][j] += 2.0*cx;
+			if(cg->fluid[i][j-1]) cg->diag[i][j] += cy;
+			if(cg->fluid[i][j+1]) cg->diag[i][j] += cy;
+			cg->diag[i][j] += cg->cnw[i][j] + cg->csw[i][j] + cg->cnw[i+1][j-1] + cg->csw[i+1][j+1];
+			/* an isolated fluid cell has no equation, keep the operator invertible */
+			if(cg->diag[i][j] == 0.0) {
+				cg->diag[i][j] = 1.0;
+			}
+
+			if(precond == PRECOND_SSOR) {
+				cg->pivot[i][j] = cg->diag[i][j]/omg;
+			}
+			else if(precond == PRECOND_IC) {
+				/* IC(0): no fill-in, only the couplings to earlier cells reduce the pivot */
+				cg->pivot[i][j] = cg->diag[i][j];
+				if(cg->fluid[i-1][j]) cg->pivot[i][j] -= cx*cx/cg->pivot[i-1][j];
+				if(cg->fluid[i][j-1]) cg->pivot[i][j] -= cy*cy/cg->pivot[i][j-1];
+				if(cg->cnw[i][j] > 0.0) cg->pivot[i][j] -= cg->cnw[i][j]*cg->cnw[i][j]/cg->pivot[i-1][j+1];
+				if(cg->csw[i][j] > 0.0) cg->pivot[i][j] -= cg->csw[i][j]*cg->csw[i][j]/cg->pivot[i-1][j-1];
+				/* the pure Neumann problem is singular, its last pivot may vanish */
+				if(cg->pivot[i][j] <= 1e-12*cg->diag[i][j]) {
+					cg->pivot[i][j] = cg->diag[i][j];
+				}
+			}
+		}
+	}
+	printf("PCG: %i fluid cells, %i corner cells, %s preconditioner\n", cg->nfluid, ncorner, names[precond]);
+}
+
+/*
+ * r = Laplacian(P) - RS on the fluid cells with the boundary values of P set as in sor(), the
+ * residual of calculate_res(). Without a Dirichlet boundary only the mean free part of the
+ * right hand side is solvable, so the mean is removed. Returns the norm of the mean free r.
+ */
+static double pressure_residual(const pcg *cg, double dx, double dy, int imax, int jmax, double **P, double **RS, double **r)
+{
+	int i, j;
+	double cx = 1.0/(dx*dx);
+	double cy = 1.0/(dy*dy);
+	double mean = 0.0;
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			if(!cg->fluid[i][j]) {
+				continue;
+			}
+			r[i][j] = cx*(P[i+1][j]-2.0*P[i][j]+P[i-1][j]) + cy*(P[i][j+1]-2.0*P[i][j]+P[i][j-1]) - RS[i][j];
+			mean += r[i][j];
+		}
+	}
+	if(!cg->left_dirichlet && !cg->right_dirichlet && cg->nfluid > 0) {
+		mean /= cg->nfluid;
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				if(cg->fluid[i][j]) {
+					r[i][j] -= mean;
+				}
+			}
+		}
+	}
+	return sqrt(dot(cg, imax, jmax, r, r)/cg->nfluid);
+}
+
+int pcg_solve(
+		pcg *cg,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double eps,
+		int    itermax,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag
+){
+	int i, j, it = 0;
+	double rz, rz_new, alpha, beta, rnorm, res_old = 0.0;
+	double **r = cg->r, **z = cg->z, **p = cg->p, **q = cg->q;
+
+	/*
+	 * CG corrects P with the residual r = A P - RS of the problem of sor(), the correction e
+	 * solves (-A) e = r. For dx = dy one solve gives that residual, otherwise the corner
+	 * couplings of CG differ and the solve is repeated with the new residual as long as it
+	 * decreases.
+	 */
+	for(;;) {
+		set_obstacle_pressure(imax, jmax, P, Flag);
+		set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+		*res = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+		if(*res <= eps || it >= itermax || (it > 0 && *res >= res_old)) {
+			break;
+		}
+		res_old = *res;
+		/* the mean of the residual of a pure Neumann problem cannot be removed by P */
+		rnorm = pressure_residual(cg, dx, dy, imax, jmax, P, RS, r);
+		if(rnorm <= eps) {
+			break;
+		}
+
+		apply_preconditioner(cg, dx, dy, imax, jmax, r, z);
+		for(i = 1; i <= imax; i++) {
+			for(j = 1; j <= jmax; j++) {
+				p[i][j] = z[i][j];
+			}
+		}
+		rz = dot(cg, imax, jmax, r, z);
+
+		while(it < itermax) {
+			apply_operator(cg, dx, dy, imax, jmax, p, q);
+			alpha = rz/dot(cg, imax, jmax, p, q);
+			for(i = 1; i <= imax; i++) {
+				for(j = 1; j <= jmax; j++) {
+					if(cg->fluid[i][j]) {
+						P[i][j] += alpha*p[i][j];
+						r[i][j] -= alpha*q[i][j];
+					}
+				}
+			}
+			it++;
+			if(sqrt(dot(cg, imax, jmax, r, r)/cg->nfluid) <= eps) {
+				break;
+			}
+			apply_preconditioner(cg, dx, dy, imax, jmax, r, z);
+			rz_new = dot(cg, imax, jmax, r, z);
+			beta = rz_new/rz;
+			rz = rz_new;
+			for(i = 1; i <= imax; i++) {
+				for(j = 1; j <= jmax; j++) {
+					if(cg->fluid[i][j]) {
+						p[i][j] = z[i][j] + beta*p[i][j];
+					}
+				}
+			}
+		}
+	}
+	return it;
+}
+
+void pcg_free(pcg *cg, int imax, int jmax)
+{
+	free_imatrix(cg->fluid, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->diag, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->cnw, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->csw, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->pivot, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->r, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->z, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->p, 0, imax+1, 0, jmax+1);
+	free_matrix(cg->q, 0, imax+1, 0, jmax+1);
+}
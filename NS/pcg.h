@@ -0,0 +1,74 @@
+#ifndef __PCG_H_
+#define __PCG_H_
+
+#include "helper.h"
+
+/**
+ * Matrix-free preconditioned conjugate gradient solver for the pressure equation. The
+ * 5-point Laplacian acts on the fluid cells only: a face to an obstacle or to a wall is a
+ * homogeneous Neumann boundary, a face to a P_L/P_R boundary uses the prescribed pressure.
+ * A corner obstacle cell (B_NO, B_NW, B_SO, B_SW) takes the mean of its two fluid neighbours
+ * as in set_obstacle_pressure(), it is eliminated into a diagonal coupling of these two cells.
+ * The coupling is symmetric for dx = dy; otherwise CG uses its symmetric mean and the
+ * difference is corrected by further solves with the residual of calculate_res().
+ * The struct keeps the fluid mask, the preconditioner and the CG vectors.
+ */
+typedef struct {
+  int precond;          /* PRECOND_JACOBI, PRECOND_SSOR or PRECOND_IC */
+  double omg;           /* relaxation factor of the SSOR preconditioner */
+  int left_dirichlet;   /* P_L: the left boundary has a prescribed pressure */
+  int right_dirichlet;  /* P_R: the right boundary has a prescribed pressure */
+  int nfluid;           /* number of fluid cells */
+  int **fluid;          /* 1 for fluid cells, 0 for obstacles and the outer boundary */
+  double **diag;        /* diagonal of the (negative) Laplacian */
+  double **cnw;         /* cnw[i][j]: coupling of (i,j) and (i-1,j+1) through a corner cell */
+  double **csw;         /* csw[i][j]: coupling of (i,j) and (i-1,j-1) through a corner cell */
+  double **pivot;       /* pivots of the incomplete Cholesky factorization */
+  double **r;           /* residual */
+  double **z;           /* preconditioned residual */
+  double **p;           /* search direction */
+  double **q;           /* operator applied to p */
+} pcg;
+
+/**
+ * Builds the fluid mask and the preconditioner (omg is used by the SSOR preconditioner).
+ */
+void pcg_init(
+  pcg *cg,
+  int imax,
+  int jmax,
+  double dx,
+  double dy,
+  int precond,
+  double omg,
+  uint8_t **Flag
+);
+
+/**
+ * Solves the pressure equation starting from P until the residual is below eps or itermax
+ * iterations are done. P is updated including the boundary values, the residual of
+ * calculate_res() is stored in res and the number of iterations is returned.
+ */
+int pcg_solve(
+  pcg *cg,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  double eps,
+  int    itermax,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag
+);
+
+/**
+ * Frees the fields of the solver.
+ */
+void pcg_free(pcg *cg, int imax, int jmax);
+
+#endif
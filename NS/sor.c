@@ -1,129 +1,919 @@
 #include "sor.h"
 #include <math.h>
+#include <limits.h>
 #include "helper.h"
 
-void sor(
-		double omg,
-		double dx,
-		double dy,
+/*
+ * Sets the pressure of the left boundary cell of row j (P_L: Dirichlet value lp or the
+ * pressure difference dp, Neumann otherwise).
+ */
+static void set_left_pressure(int j, double **P, double lp, double dp, uint8_t **Flag)
+{
+	if((Flag[0][j]&P_L)==P_L){
+		if(lp>=0){
+			P[0][j] = 2*lp-P[1][j];
+		}
+		else if(dp!=0){
+			P[0][j] = 2*dp-P[1][j];
+		}
+	}
+	else{
+		P[0][j] = P[1][j];
+	}
+}
+
+/*
+ * Sets the pressure of the right boundary cell of row j (P_R: Dirichlet value rp or the
+ * pressure difference dp, Neumann otherwise).
+ */
+static void set_right_pressure(int imax, int j, double **P, double rp, double dp, uint8_t **Flag)
+{
+	if((Flag[imax+1][j]&P_R)==P_R){
+		if(rp>=0){
+			P[imax+1][j] = 2*rp-P[imax][j];
+		}
+		else if(dp!=0){
+			P[imax+1][j] = -P[imax][j];
+		}
+	}
+	else{
+		P[imax+1][j] = P[imax][j];
+	}
+}
+
+/*
+ * Sets the pressure in the outer boundary cells: homogeneous Neumann conditions, or the
+ * Dirichlet values lp/rp (or the pressure difference dp) where the flags P_L/P_R are set.
+ */
+void set_outer_pressure(
 		int    imax,
 		int    jmax,
 		double **P,
-		double **RS,
-		double *res,
 		double lp,
 		double rp,
 		double dp,
-		int **Flag
+		uint8_t **Flag
 ) {
 	int i,j;
-	double rloc;
-	double coeff = omg/(2.0*(1.0/(dx*dx)+1.0/(dy*dy)));
-	int count;
-
-	count = 0;
+	for(i = 1; i <= imax; i++) {
+		P[i][0] = P[i][1];
+		P[i][jmax+1] = P[i][jmax];
+	}
+	for(j = 1; j <= jmax; j++) {
+		/*left boundary (this can be modified if a pressure value must be assigned to
+		 * this boundary) */
+		set_left_pressure(j, P, lp, dp, Flag);
+		/*right (this can be modified if a pressure value must be assigned to
+		 * this boundary)*/
+		set_right_pressure(imax, j, P, rp, dp, Flag);
+	}
+}
 
-	/* SOR iteration */
+/*
+ * Sets the pressure of the obstacle cells that have fluid neighbours to the value of
+ * (the mean of) the neighbouring fluid cells.
+ */
+void set_obstacle_pressure(
+		int    imax,
+		int    jmax,
+		double **P,
+		uint8_t **Flag
+) {
+	int i,j,c;
+	const int ld = MATRIX_LD(P);
+	double *p = P[0];
+	const uint8_t *restrict fl = Flag[0];
 	for(i = 1; i <= imax; i++) {
-		for(j = 1; j<=jmax; j++) {
-			/*
-			 * Check if it is a fluid cell and calculate the pressure normally
-			 */
-			if((Flag[i][j]&B_C)==B_C){
-				P[i][j] = (1.0-omg)*P[i][j] + coeff*(( P[i+1][j]+P[i-1][j])/(dx*dx) +
-						( P[i][j+1]+P[i][j-1])/(dy*dy) - RS[i][j]);
-				/*
-				 * Store number of fluid cells
-				 */
-				count++;
+		for(j = 1; j <= jmax; j++) {
+			c = mat_idx(i, j, ld);
+			if((fl[c]&31)==B_N){
+				p[c]=p[c+1];
 			}
-			/*
-			 * If it's not a fluid cell but it has fluid cell neighbors, some values must still
-			 * be calculated using the boundary flags.
-			 */
-			else if((Flag[i][j]&31)==B_N){
-				P[i][j]=P[i][j+1];
+			else if((fl[c]&31)==B_S){
+				p[c]=p[c-1];
+			}
+			else if((fl[c]&31)==B_W){
+				p[c]=p[c-ld];
 			}
-			else if((Flag[i][j]&31)==B_S){
-				P[i][j]=P[i][j-1];
+			else if((fl[c]&31)==B_O){
+				p[c]=p[c+ld];
 			}
-			else if((Flag[i][j]&31)==B_W){
-				P[i][j]=P[i-1][j];
+			else if((fl[c]&31)==B_NO){
+				p[c]=(p[c+ld]+p[c+1])/2.0;
 			}
-			else if((Flag[i][j]&31)==B_O){
-				P[i][j]=P[i+1][j];
+			else if((fl[c]&31)==B_NW){
+				p[c]=(p[c+1]+p[c-ld])/2.0;
 			}
-			else if((Flag[i][j]&31)==B_NO){
-				P[i][j]=(P[i+1][j]+P[i][j+1])/2.0;
+			else if((fl[c]&31)==B_SO){
+				p[c]=(p[c-1]+p[c+ld])/2.0;
 			}
-			else if((Flag[i][j]&31)==B_NW){
-				P[i][j]=(P[i][j+1]+P[i-1][j])/2.0;
+			else if((fl[c]&31)==B_SW){
+				p[c]=(p[c-1]+p[c-ld])/2.0;
+			}
+		}
+	}
+}
+
+/*
+ * Sets the pressure of the boundary cells from the cell lists whose flat index is below end,
+ * starting at the positions kb[] in the lists of the types, and advances kb[]. The lists are
+ * ordered by rows, so a sweep can set the boundary cells row by row.
+ */
+static void set_boundary_cells(double *p, int ld, const cell_lists *cells, int *kb, int end)
+{
+	int k,c;
+	for(k = kb[CELL_N]; k < cells->nbnd[CELL_N] && (c = cells->bnd[CELL_N][k]) < end; k++){
+		p[c]=p[c+1];
+	}
+	kb[CELL_N] = k;
+	for(k = kb[CELL_S]; k < cells->nbnd[CELL_S] && (c = cells->bnd[CELL_S][k]) < end; k++){
+		p[c]=p[c-1];
+	}
+	kb[CELL_S] = k;
+	for(k = kb[CELL_W]; k < cells->nbnd[CELL_W] && (c = cells->bnd[CELL_W][k]) < end; k++){
+		p[c]=p[c-ld];
+	}
+	kb[CELL_W] = k;
+	for(k = kb[CELL_O]; k < cells->nbnd[CELL_O] && (c = cells->bnd[CELL_O][k]) < end; k++){
+		p[c]=p[c+ld];
+	}
+	kb[CELL_O] = k;
+	for(k = kb[CELL_NO]; k < cells->nbnd[CELL_NO] && (c = cells->bnd[CELL_NO][k]) < end; k++){
+		p[c]=(p[c+ld]+p[c+1])/2.0;
+	}
+	kb[CELL_NO] = k;
+	for(k = kb[CELL_NW]; k < cells->nbnd[CELL_NW] && (c = cells->bnd[CELL_NW][k]) < end; k++){
+		p[c]=(p[c+1]+p[c-ld])/2.0;
+	}
+	kb[CELL_NW] = k;
+	for(k = kb[CELL_SO]; k < cells->nbnd[CELL_SO] && (c = cells->bnd[CELL_SO][k]) < end; k++){
+		p[c]=(p[c-1]+p[c+ld])/2.0;
+	}
+	kb[CELL_SO] = k;
+	for(k = kb[CELL_SW]; k < cells->nbnd[CELL_SW] && (c = cells->bnd[CELL_SW][k]) < end; k++){
+		p[c]=(p[c-1]+p[c-ld])/2.0;
+	}
+	kb[CELL_SW] = k;
+}
+
+void set_obstacle_pressure_cells(double **P, const cell_lists *cells)
+{
+	int kb[CELL_TYPES] = {0};
+	set_boundary_cells(P[0], MATRIX_LD(P), cells, kb, INT_MAX);
+}
+
+/*
+ * Relaxes row i in the order of j and returns the number of its fluid cells: the obstacle
+ * cells in front of a span of fluid cells (kb[] are the positions in the boundary lists) are
+ * set before the span is relaxed, those behind the last span after it. The spans are maximal
+ * runs of fluid cells, so this is the order of the plain Gauss-Seidel sweep over the row.
+ */
+static int relax_row(
+		double *p,
+		const double *restrict rs,
+		int ld,
+		const cell_lists *cells,
+		int *kb,
+		int i,
+		double omg,
+		double coeff,
+		double dx,
+		double dy
+) {
+	int k,c,n = 0;
+	for(k = cells->span_first[i]; k < cells->span_first[i+1]; k++) {
+		set_boundary_cells(p, ld, cells, kb, cells->span[2*k]);
+		for(c = cells->span[2*k]; c < cells->span[2*k+1]; c++) {
+			p[c] = (1.0-omg)*p[c] + coeff*(( p[c+ld]+p[c-ld])/(dx*dx) +
+					( p[c+1]+p[c-1])/(dy*dy) - rs[c]);
+		}
+		n += cells->span[2*k+1] - cells->span[2*k];
+	}
+	set_boundary_cells(p, ld, cells, kb, mat_idx(i+1, 0, ld));
+	return n;
+}
+
+/*
+ * Adds the squared residuals of the n fluid cells in the list fluid to rloc and their number
+ * to count.
+ */
+static void fluid_residual(
+		const int *fluid,
+		int    n,
+		double dx,
+		double dy,
+		double **P,
+		double **RS,
+		double *rloc,
+		int *count
+) {
+	int k,c;
+	const int ld = MATRIX_LD(P);
+	const double *p = P[0];
+	const double *restrict rs = RS[0];
+	double r;
+	for(k = 0; k < n; k++) {
+		c = fluid[k];
+		r = (p[c+ld]-2.0*p[c]+p[c-ld])/(dx*dx) + ( p[c+1]-2.0*p[c]+p[c-1])/(dy*dy) - rs[c];
+		*rloc += r*r;
+	}
+	*count += n;
+}
+
+/*
+ * Residual of the pressure equation, the L2 norm over the fluid cells divided by the number
+ * of fluid cells.
+ */
+double calculate_res(
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		uint8_t **Flag
+) {
+	int i,j,c;
+	int count = 0;
+	double rloc = 0.0;
+	const int ld = MATRIX_LD(P);
+	const double *p = P[0];
+	const double *restrict rs = RS[0];
+	const uint8_t *restrict fl = Flag[0];
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			c = mat_idx(i, j, ld);
+			/*
+			 * Check for only fluid cells
+			 */
+			if((fl[c]&B_C)==B_C){
+				count++;
+				rloc += ( (p[c+ld]-2.0*p[c]+p[c-ld])/(dx*dx) + ( p[c+1]-2.0*p[c]+p[c-1])/(dy*dy) - rs[c])*
+						( (p[c+ld]-2.0*p[c]+p[c-ld])/(dx*dx) + ( p[c+1]-2.0*p[c]+p[c-1])/(dy*dy) - rs[c]);
 			}
-			else if((Flag[i][j]&31)==B_SO){
-				P[i][j]=(P[i][j-1]+P[i+1][j])/2.0;
+		}
+	}
+	/*
+	 * Calculate the residual by dividing only by the number of fluid cells!
+	 */
+	rloc = rloc/((double)count);
+	rloc = sqrt(rloc);
+	return rloc;
+}
+
+double rs_norm(
+		int    imax,
+		int    jmax,
+		double **RS,
+		uint8_t **Flag
+) {
+	int i,j,c;
+	int count = 0;
+	double sum = 0.0;
+	const int ld = MATRIX_LD(RS);
+	const double *restrict rs = RS[0];
+	const uint8_t *restrict fl = Flag[0];
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			c = mat_idx(i, j, ld);
+			if((fl[c]&B_C)==B_C){
+				sum += rs[c]*rs[c];
+				count++;
 			}
-			else if((Flag[i][j]&31)==B_SW){
-				P[i][j]=(P[i][j-1]+P[i-1][j])/2.0;
+		}
+	}
+	return (count > 0) ? sqrt(sum/((double)count)) : 0.0;
+}
+
+double max_res(
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		uint8_t **Flag
+) {
+	int i,j,c;
+	double r, rmax = 0.0;
+	const int ld = MATRIX_LD(P);
+	const double *p = P[0];
+	const double *restrict rs = RS[0];
+	const uint8_t *restrict fl = Flag[0];
+
+	for(i = 1; i <= imax; i++) {
+		for(j = 1; j <= jmax; j++) {
+			c = mat_idx(i, j, ld);
+			if((fl[c]&B_C)==B_C){
+				r = fabs((p[c+ld]-2.0*p[c]+p[c-ld])/(dx*dx) +
+						(p[c+1]-2.0*p[c]+p[c-1])/(dy*dy) - rs[c]);
+				if(r > rmax){
+					rmax = r;
+				}
 			}
 		}
 	}
+	return rmax;
+}
 
+void sor(
+		double omg,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag,
+		const cell_lists *cells
+) {
+	int i,j;
+	int kf = 0, k0 = 0, k1;
+	int kb[CELL_TYPES] = {0};
+	int count = 0;
+	double rloc = 0.0;
+	double coeff = omg/(2.0*(1.0/(dx*dx)+1.0/(dy*dy)));
+	const int ld = MATRIX_LD(P);
+	double *p = P[0];
+	const double *restrict rs = RS[0];
+	const int *restrict fluid = cells->fluid;
+
+	/* SOR iteration */
+	for(i = 1; i <= imax; i++) {
+		/*
+		 * The fluid cells of row i, they are the next entries of the fluid list. The
+		 * obstacle cells next to the fluid take the values of their fluid neighbours in
+		 * between.
+		 */
+		k1 = kf;
+		kf += relax_row(p, rs, ld, cells, kb, i, omg, coeff, dx, dy);
+		/*
+		 * Row i is final for this sweep, so the residual of row i-1 is computed now, one
+		 * row behind the sweep while its values are still in cache. The boundary values of
+		 * the rows are set here already; the sweep does not read them again, the result
+		 * is the same as calculate_res() after the sweep.
+		 */
+		if(res != NULL){
+			P[i][0] = P[i][1];
+			P[i][jmax+1] = P[i][jmax];
+			if(i == 1){
+				for(j = 1; j <= jmax; j++){
+					set_left_pressure(j, P, lp, dp, Flag);
+				}
+			}
+			else{
+				fluid_residual(fluid + k0, k1 - k0, dx, dy, P, RS, &rloc, &count);
+			}
+		}
+		k0 = k1;
+	}
 
 	/* set outer boundary values */
-			for(i = 1; i <= imax; i++) {
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+
+	/* residual of the last row, which needs the right boundary values */
+	if(res != NULL){
+		fluid_residual(fluid + k0, kf - k0, dx, dy, P, RS, &rloc, &count);
+		*res = sqrt(rloc/((double)count));
+	}
+}
+
+/*
+ * Temporally blocked SOR: nt sweeps run together as a wavefront over the rows, sweep t relaxes
+ * row s-t in step s. Sweep t+1 reaches row i right after sweep t has finished row i+1, so
+ * every row sees exactly the neighbour values it sees in consecutive sweeps, and only a band
+ * of about nt rows of P and RS is in use in a step, which stays in cache. The outer boundary
+ * values of a row are set as soon as the sweep has finished the row (the left and right
+ * boundary after the first and the last row), as set_outer_pressure() would at the end of the
+ * sweep: the sweep does not read them again, the next sweep reads them only after that.
+ */
+void sor_wavefront(
+		double omg,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		int    nsweeps,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag,
+		const cell_lists *cells
+) {
+	int i,j,k,s,t,nt,done;
+	int kb[SOR_WAVEFRONT][CELL_TYPES];
+	int count = 0;
+	double rloc = 0.0;
+	double coeff = omg/(2.0*(1.0/(dx*dx)+1.0/(dy*dy)));
+	const int ld = MATRIX_LD(P);
+	double *p = P[0];
+	const double *restrict rs = RS[0];
 
+	/* at most SOR_WAVEFRONT sweeps in flight, more sweeps run as several waves */
+	for(done = 0; done < nsweeps; done += nt) {
+		nt = (nsweeps - done < SOR_WAVEFRONT) ? nsweeps - done : SOR_WAVEFRONT;
+		for(t = 0; t < nt; t++) {
+			for(k = 0; k < CELL_TYPES; k++) {
+				kb[t][k] = 0;
+			}
+		}
+		for(s = 1; s < imax + nt; s++) {
+			for(t = 0; t < nt; t++) {
+				i = s - t;
+				if(i < 1 || i > imax) {
+					continue;
+				}
+				relax_row(p, rs, ld, cells, kb[t], i, omg, coeff, dx, dy);
 				P[i][0] = P[i][1];
 				P[i][jmax+1] = P[i][jmax];
+				if(i == 1) {
+					for(j = 1; j <= jmax; j++) {
+						set_left_pressure(j, P, lp, dp, Flag);
+					}
+				}
+				if(i == imax) {
+					for(j = 1; j <= jmax; j++) {
+						set_right_pressure(imax, j, P, rp, dp, Flag);
+					}
+				}
 			}
-			for(j = 1; j <= jmax; j++) {
-				/*left boundary (this can be modified if a pressure value must be assigned to
-				 * this boundary) */
+		}
+	}
 
-				if((Flag[0][j]&P_L)==P_L){
-					if(lp>=0){
-						P[0][j] = 2*lp-P[1][j];
-					}
-					else if(dp!=0){
-						P[0][j] = 2*dp-P[1][j];
+	/* residual after the last sweep */
+	if(res != NULL){
+		fluid_residual(cells->fluid, cells->nfluid, dx, dy, P, RS, &rloc, &count);
+		*res = sqrt(rloc/((double)count));
+	}
+}
+
+/*
+ * Red-black ordered SOR. The cells with i+j even (red) only depend on black cells and vice
+ * versa, so every half sweep has no dependence on its own updates: the rows are distributed
+ * over the threads and the inner loop runs with stride 2 without branches. A row is swept in
+ * blocks of 64 cells along the words of the fluid mask: blocks without fluid are skipped, all
+ * fluid blocks are relaxed without any test, only blocks at an obstacle select by the bits.
+ */
+void sor_redblack(
+		double omg,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag,
+		const cell_lists *cells
+) {
+	int i,j;
+	int color;
+	int count = 0;
+	double rloc = 0.0;
+	double coeff = omg/(2.0*(1.0/(dx*dx)+1.0/(dy*dy)));
+	double rdx2 = 1.0/(dx*dx);
+	double rdy2 = 1.0/(dy*dy);
+	const int ld = MATRIX_LD(P);
+	double *p = P[0];
+	const double *restrict rs = RS[0];
+	const uint64_t *restrict mask = cells->fluid_mask;
+	const int ldm = cells->ldm;
+
+	for(color = 0; color < 2; color++) {
+		#pragma omp parallel for private(j) schedule(static)
+		for(i = 1; i <= imax; i++) {
+			int w, lo, hi;
+			uint64_t m, full;
+			for(w = 0; 64*w <= jmax; w++) {
+				m = mask[i*ldm + w];
+				if(m == 0) {
+					continue;
+				}
+				/* inner cells of the block, the first of them with the color of this sweep */
+				lo = (w == 0) ? 1 : 64*w;
+				hi = (64*w + 63 < jmax) ? 64*w + 63 : jmax;
+				full = (~(uint64_t)0 >> (63 - (hi - lo))) << (lo - 64*w);
+				lo += (lo + i + color) & 1;
+				if(m == full) {
+					#pragma omp simd
+					for(j = lo; j <= hi; j += 2) {
+						int c = mat_idx(i, j, ld);
+						p[c] = (1.0-omg)*p[c] + coeff*((p[c+ld]+p[c-ld])*rdx2 + (p[c+1]+p[c-1])*rdy2 - rs[c]);
 					}
 				}
-				else{
-					P[0][j] = P[1][j];
+				else {
+					for(j = lo; j <= hi; j += 2) {
+						int c = mat_idx(i, j, ld);
+						if((m >> (j - 64*w)) & 1) {
+							p[c] = (1.0-omg)*p[c] + coeff*((p[c+ld]+p[c-ld])*rdx2 + (p[c+1]+p[c-1])*rdy2 - rs[c]);
+						}
+					}
 				}
-				/*right (this can be modified if a pressure value must be assigned to
-				 * this boundary)*/
+			}
+		}
+	}
 
-				if((Flag[imax+1][j]&P_R)==P_R){
-					if(rp>=0){
-						P[imax+1][j] = 2*rp-P[imax][j];
+	/* obstacle cells next to the fluid take the values of their fluid neighbours */
+	set_obstacle_pressure_cells(P, cells);
+
+	/* set outer boundary values */
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+
+	/* compute the residual */
+	if(res != NULL){
+		fluid_residual(cells->fluid, cells->nfluid, dx, dy, P, RS, &rloc, &count);
+		*res = sqrt(rloc/((double)count));
+	}
+}
+
+/*
+ * Thomas algorithm for -off x[k-1] + b[k] x[k] - off x[k+1] = d[k], k = 0..n-1. The solution
+ * overwrites d, cp is scratch space.
+ */
+static void solve_tridiagonal(int n, double off, const double *b, double *d, double *cp)
+{
+	int k;
+	double denom;
+
+	cp[0] = -off/b[0];
+	d[0] = d[0]/b[0];
+	for(k = 1; k < n; k++) {
+		denom = b[k] + off*cp[k-1];
+		cp[k] = -off/denom;
+		d[k] = (d[k] + off*d[k-1])/denom;
+	}
+	for(k = n-2; k >= 0; k--) {
+		d[k] -= cp[k]*d[k+1];
+	}
+}
+
+/*
+ * Zebra line SOR: the odd lines and then the even lines are solved exactly with the Thomas
+ * algorithm with the neighbouring lines fixed, and the line solution is over-relaxed with omg.
+ * The lines run along the direction of the stronger coupling (the smaller mesh width), for
+ * equal mesh widths along the longer side of the domain. Lines of one color do not depend on
+ * each other and are solved in parallel. The fluid cells of a line are split into segments by
+ * the obstacles. Ends of a segment at a Neumann or Dirichlet boundary or at an obstacle cell
+ * that copies the end cell are treated implicitly, the averaging corner cells keep their
+ * current value.
+ *
+ * Alternating the direction between the sweeps (line ADI) is not done: combined with
+ * over-relaxation it converges slower than the zebra sweeps of one direction.
+ */
+void sor_line(
+		double omg,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **RS,
+		double *res,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag,
+		const cell_lists *cells
+) {
+	double rdx2 = 1.0/(dx*dx);
+	double rdy2 = 1.0/(dy*dy);
+	double diag = 2.0*(rdx2+rdy2);
+	int nmax = (imax > jmax ? imax : jmax) + 2;
+	/* prescribed pressures of the outer boundaries as in set_outer_pressure() */
+	int left_dirichlet = (lp >= 0 || dp != 0);
+	int right_dirichlet = (rp >= 0 || dp != 0);
+	double gl = (lp >= 0) ? lp : dp;
+	double gr = (rp >= 0) ? rp : 0.0;
+	int rows = (rdx2 > rdy2 || (rdx2 == rdy2 && imax >= jmax));
+
+	#pragma omp parallel
+	{
+		int i, j, k, s, e, color;
+		double *b = (double *) malloc((size_t)(nmax*sizeof(double)));
+		double *d = (double *) malloc((size_t)(nmax*sizeof(double)));
+		double *cp = (double *) malloc((size_t)(nmax*sizeof(double)));
+		if(b == NULL || d == NULL || cp == NULL) ERROR("Storage cannot be allocated");
+
+		/* rows (lines of constant j) */
+		for(color = 0; color < 2 && rows; color++) {
+			#pragma omp for schedule(static)
+			for(j = 1 + color; j <= jmax; j += 2) {
+				for(s = 1; s <= imax; s = e + 1) {
+					if((Flag[s][j]&B_C)!=B_C) {
+						e = s;
+						continue;
+					}
+					for(e = s; e < imax && (Flag[e+1][j]&B_C)==B_C; e++);
+					for(i = s; i <= e; i++) {
+						b[i-s] = diag;
+						d[i-s] = (P[i][j-1]+P[i][j+1])*rdy2 - RS[i][j];
+					}
+					if(s == 1 && (Flag[0][j]&P_L)==P_L && left_dirichlet) {
+						b[0] += rdx2;
+						d[0] += 2.0*gl*rdx2;
+					}
+					else if(s == 1 || (Flag[s-1][j]&31)==B_O) {
+						b[0] -= rdx2;
+					}
+					else {
+						d[0] += P[s-1][j]*rdx2;
+					}
+					if(e == imax && (Flag[imax+1][j]&P_R)==P_R && right_dirichlet) {
+						b[e-s] += rdx2;
+						d[e-s] += 2.0*gr*rdx2;
+					}
+					else if(e == imax || (Flag[e+1][j]&31)==B_W) {
+						b[e-s] -= rdx2;
+					}
+					else {
+						d[e-s] += P[e+1][j]*rdx2;
 					}
-					else if(dp!=0){
-						P[imax+1][j] = -P[imax][j];
+					solve_tridiagonal(e-s+1, rdx2, b, d, cp);
+					for(i = s; i <= e; i++) {
+						P[i][j] += omg*(d[i-s] - P[i][j]);
 					}
 				}
-				else{
-					P[imax+1][j] = P[imax][j];
+			}
+		}
+
+		/* columns (lines of constant i), the top and bottom walls are Neumann boundaries */
+		for(color = 0; color < 2 && !rows; color++) {
+			#pragma omp for schedule(static)
+			for(i = 1 + color; i <= imax; i += 2) {
+				for(s = 1; s <= jmax; s = e + 1) {
+					if((Flag[i][s]&B_C)!=B_C) {
+						e = s;
+						continue;
+					}
+					for(e = s; e < jmax && (Flag[i][e+1]&B_C)==B_C; e++);
+					for(j = s; j <= e; j++) {
+						b[j-s] = diag;
+						d[j-s] = (P[i-1][j]+P[i+1][j])*rdx2 - RS[i][j];
+					}
+					if(s == 1 || (Flag[i][s-1]&31)==B_N) {
+						b[0] -= rdy2;
+					}
+					else {
+						d[0] += P[i][s-1]*rdy2;
+					}
+					if(e == jmax || (Flag[i][e+1]&31)==B_S) {
+						b[e-s] -= rdy2;
+					}
+					else {
+						d[e-s] += P[i][e+1]*rdy2;
+					}
+					solve_tridiagonal(e-s+1, rdy2, b, d, cp);
+					for(k = 0, j = s; j <= e; j++, k++) {
+						P[i][j] += omg*(d[k] - P[i][j]);
+					}
 				}
 			}
+		}
+
+		free(b);
+		free(d);
+		free(cp);
+	}
+
+	/* obstacle cells next to the fluid take the values of their fluid neighbours */
+	set_obstacle_pressure_cells(P, cells);
+
+	/* set outer boundary values */
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
 
 	/* compute the residual */
-	rloc = 0.0;
+	if(res != NULL){
+		*res = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+	}
+}
+
+int extrapolate_pressure(
+		int    history,
+		double factor,
+		double dx,
+		double dy,
+		int    imax,
+		int    jmax,
+		double **P,
+		double **P_prev,
+		double **P_save,
+		double **RS,
+		double *res_old,
+		double *res_new,
+		double lp,
+		double rp,
+		double dp,
+		uint8_t **Flag
+) {
+	int i,j;
+
+	for(i = 0; i <= imax+1; i++) {
+		for(j = 0; j <= jmax+1; j++) {
+			P_save[i][j] = P[i][j];
+		}
+	}
+	if(history < 2) {
+		return 0;
+	}
+
+	/* P holds the boundary values of the last solve, so its residual for the new RS is exact */
+	*res_old = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
 	for(i = 1; i <= imax; i++) {
 		for(j = 1; j <= jmax; j++) {
-			/*
-			 * Check for only fluid cells
-			 */
 			if((Flag[i][j]&B_C)==B_C){
-				rloc += ( (P[i+1][j]-2.0*P[i][j]+P[i-1][j])/(dx*dx) + ( P[i][j+1]-2.0*P[i][j]+P[i][j-1])/(dy*dy) - RS[i][j])*
-						( (P[i+1][j]-2.0*P[i][j]+P[i-1][j])/(dx*dx) + ( P[i][j+1]-2.0*P[i][j]+P[i][j-1])/(dy*dy) - RS[i][j]);
+				P[i][j] = P_save[i][j] + factor*(P_save[i][j] - P_prev[i][j]);
 			}
 		}
 	}
-	/*
-	 * Calculate the residual by dividing only by the number of fluid cells!
-	 */
-	rloc = rloc/((double)count);
-	rloc = sqrt(rloc);
-	/* set residual */
-	*res = rloc;
+	set_obstacle_pressure(imax, jmax, P, Flag);
+	set_outer_pressure(imax, jmax, P, lp, rp, dp, Flag);
+	*res_new = calculate_res(dx, dy, imax, jmax, P, RS, Flag);
+	if(*res_new < *res_old) {
+		return 1;
+	}
+
+	/* the extrapolation is worse than the last solution, start from that one */
+	for(i = 0; i <= imax+1; i++) {
+		for(j = 0; j <= jmax+1; j++) {
+			P[i][j] = P_save[i][j];
+		}
+	}
+	*res_new = *res_old;
+	return 0;
+}
+
+
+/* steps with omg_init at the start, range of the search step, each OMG_REF-th round is a comparison with omg_init */
+#define OMG_START 5
+#define OMG_DELTA_MIN 0.01
+#define OMG_DELTA_MAX 0.05
+#define OMG_REF 8
+
+/*
+ * Factor of step s of a round. The order is symmetric in time, so a trend of the iterations
+ * during the round (the flow develops) affects all factors the same. The search rounds compare
+ * omg - delta, omg and omg + delta, the comparison rounds omg and omg_init.
+ */
+static const int omg_order[6] = {0, 1, 2, 2, 1, 0};
+static const int ref_order[4] = {1, 2, 2, 1};
+
+/*
+ * Sets the factors of the next round.
+ */
+static void omg_round(omg_tuner *ot)
+{
+	ot->round++;
+	ot->steps = 0;
+	ot->its[0] = ot->its[1] = ot->its[2] = 0;
+	ot->lres[0] = ot->lres[1] = ot->lres[2] = 0.0;
+	ot->cand[1] = ot->omg;
+	if(ot->round % OMG_REF == 0) {
+		ot->cand[2] = ot->omg_init;
+	}
+	else {
+		ot->cand[0] = fmax(ot->omg - ot->delta, 1.0);
+		ot->cand[2] = fmin(ot->omg + ot->delta, ot->omg_max);
+	}
+}
+
+/*
+ * Factor of the current step of the round.
+ */
+static double omg_current(const omg_tuner *ot)
+{
+	if(ot->round % OMG_REF == 0) {
+		return ot->cand[ref_order[ot->steps]];
+	}
+	return ot->cand[omg_order[ot->steps]];
+}
+
+void omg_tune_init(omg_tuner *ot, double omg)
+{
+	ot->omg_init = omg;
+	ot->omg = omg;
+	ot->delta = OMG_DELTA_MAX;
+	ot->omg_max = 1.95;
+	ot->mu2 = 0.0;
+	ot->steps = 0;
+	ot->round = 0;
+	ot->cand[0] = ot->cand[1] = ot->cand[2] = omg;
+	ot->its[0] = ot->its[1] = ot->its[2] = 0;
+	ot->lres[0] = ot->lres[1] = ot->lres[2] = 0.0;
+	ot->ref_its[0] = ot->ref_its[1] = 0;
+	ot->ref_steps = 0;
+	ot->it_a = ot->it_b = ot->it_c = 0;
+	ot->res_a = ot->res_b = ot->res_c = 0.0;
+	ot->iterations = 0;
+}
+
+void omg_tune_check(omg_tuner *ot, int it, double res)
+{
+	/* the window starts between a quarter and a half of the iterations, after the fast modes have died out */
+	if(ot->it_b == 0) {
+		ot->it_a = ot->it_b = it;
+		ot->res_a = ot->res_b = res;
+	}
+	else if(it >= 2*ot->it_b) {
+		ot->it_a = ot->it_b;
+		ot->res_a = ot->res_b;
+		ot->it_b = it;
+		ot->res_b = res;
+	}
+	ot->it_c = it;
+	ot->res_c = res;
+}
+
+double omg_tune_update(omg_tuner *ot, int n, double omg, int it)
+{
+	int k, best, span = ot->it_c - ot->it_a;
+	double lambda, mu2, lres = (ot->res_c > 0.0) ? log10(ot->res_c) : 0.0;
+
+	ot->iterations += it;
+
+	/* spectral radius from the later part of the solves with omg_init */
+	if(ot->round == 0 && span >= 8 && ot->res_c > 0.0 && ot->res_c < ot->res_a) {
+		lambda = pow(ot->res_c/ot->res_a, 1.0/span);
+		/* close to omg - 1 the iteration is near the optimum and the relation ill-conditioned */
+		if(lambda > omg-1.0 + 0.2*(2.0-omg)) {
+			mu2 = (lambda+omg-1.0)*(lambda+omg-1.0)/(lambda*omg*omg);
+			if(mu2 > ot->mu2 && mu2 < 1.0) {
+				ot->mu2 = mu2;
+			}
+		}
+	}
+	ot->it_a = ot->it_b = ot->it_c = 0;
+
+	if(ot->round == 0) {
+		if(++ot->steps < OMG_START) {
+			return ot->omg_init;
+		}
+		if(ot->mu2 > 0.0) {
+			ot->omg_max = 2.0/(1.0+sqrt(1.0-ot->mu2));
+		}
+		ot->omg = fmin(ot->omg_init, ot->omg_max);
+		printf("Time step %i: Jacobi spectral radius %.5f, asymptotically optimal omg %.3f\n",
+				n, sqrt(ot->mu2), ot->omg_max);
+		omg_round(ot);
+		return omg_current(ot);
+	}
+
+	if(ot->round % OMG_REF == 0) {
+		k = ref_order[ot->steps];
+		ot->ref_its[k/2] += it;
+		ot->ref_steps += k/2;
+		if(++ot->steps < 4) {
+			return omg_current(ot);
+		}
+		omg_round(ot);
+		return omg_current(ot);
+	}
+
+	k = omg_order[ot->steps];
+	ot->its[k] += it;
+	ot->lres[k] += lres;
+	if(++ot->steps < 6) {
+		return omg_current(ot);
+	}
+	/* solves that stop at itermax are compared by their residuals */
+	best = 1;
+	for(k = 0; k <= 2; k += 2) {
+		if(ot->cand[k] != ot->omg && (ot->its[k] < ot->its[best] ||
+				(ot->its[k] == ot->its[best] && ot->lres[k] < ot->lres[best]))) {
+			best = k;
+		}
+	}
+	if(best == 1) {
+		ot->delta = fmax(0.5*ot->delta, OMG_DELTA_MIN);
+	}
+	else {
+		ot->delta = fmin(2.0*ot->delta, OMG_DELTA_MAX);
+		ot->omg = ot->cand[best];
+		printf("Time step %i: omg %.3f (%.1f iterations per step, %.1f with omg %.3f)\n",
+				n, ot->omg, 0.5*ot->its[best], 0.5*ot->its[1], ot->cand[1]);
+	}
+	omg_round(ot);
+	return omg_current(ot);
+}
+
+void omg_tune_report(const omg_tuner *ot)
+{
+	printf("SOR relaxation factor omg = %.3f (%.3f in the parameter file), %i iterations\n",
+			ot->omg, ot->omg_init, ot->iterations);
+	if(ot->ref_steps > 0) {
+		printf("Comparison steps: %.1f iterations per step with the tuned omg, %.1f with omg %.3f (%+.0f%%)\n",
+				(double)ot->ref_its[0]/ot->ref_steps, (double)ot->ref_its[1]/ot->ref_steps, ot->omg_init,
+				ot->ref_its[1] > 0 ? 100.0*(ot->ref_its[0] - ot->ref_its[1])/ot->ref_its[1] : 0.0);
+	}
 }
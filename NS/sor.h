@@ -1,12 +1,20 @@
 #ifndef __SOR_H_
 #define __SOR_H_
 
+#include "helper.h"
+
 /**
  * One GS iteration for the pressure Poisson equation. Besides, the routine must 
  * also set the boundary values for P according to the specification. The 
  * residual for the termination criteria has to be stored in res.
  * 
  * An \omega = 1 GS - implementation is given within sor.c.
+ *
+ * The residual is accumulated during the sweep, one row behind the relaxation. If res is
+ * NULL the residual is not computed (the iterations without a convergence check).
+ *
+ * The sweep runs over the fluid spans of the rows, the obstacle cells of each row are set
+ * from the boundary cell lists after the fluid cells of the row.
  */
 void sor(
   double omg,
@@ -20,8 +28,226 @@ void sor(
   double lp,
   double rp,
   double dp,
-  int **Flag
+  uint8_t **Flag,
+  const cell_lists *cells
+);
+
+/**
+ * Maximum number of sweeps of sor_wavefront() in flight at a time.
+ */
+#define SOR_WAVEFRONT 32
+
+/**
+ * nsweeps iterations of sor() in one pass over the grid: the sweeps run as a skewed wavefront
+ * over the rows, so a band of rows stays in cache for all of them instead of streaming P and
+ * RS once per sweep. The result is the same as nsweeps calls of sor(); the residual after the
+ * last sweep is stored in res (if res is not NULL).
+ */
+void sor_wavefront(
+  double omg,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  int    nsweeps,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag,
+  const cell_lists *cells
+);
+
+/**
+ * One red-black ordered SOR iteration. The two colors are relaxed one after the other, each
+ * color in parallel over the rows. The obstacle cells and the outer boundary values are set
+ * afterwards as in sor(), the residual is stored in res (if res is not NULL).
+ */
+void sor_redblack(
+  double omg,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag,
+  const cell_lists *cells
+);
+
+/**
+ * One zebra line SOR iteration: the grid lines along the more strongly coupled direction are
+ * solved exactly with the Thomas algorithm (split into segments at the obstacles), odd lines
+ * before even lines. The boundary values are set and the residual is stored in res (if res is
+ * not NULL) as in sor().
+ */
+void sor_line(
+  double omg,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  double *res,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag,
+  const cell_lists *cells
+);
+
+/**
+ * Initial guess of the pressure solve by linear extrapolation in time,
+ * P + factor (P - P_prev) with factor = dt_new/dt_old, which is second order accurate.
+ * P is first copied to P_save, the history for the next step. The extrapolation needs two
+ * previous solutions (history >= 2) and is only kept if its residual res_new is smaller than
+ * the residual res_old of the last solution, otherwise P is restored. Returns 1 if the
+ * extrapolated guess is used.
+ */
+int extrapolate_pressure(
+  int    history,
+  double factor,
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **P_prev,
+  double **P_save,
+  double **RS,
+  double *res_old,
+  double *res_new,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag
 );
 
+/**
+ * Automatic choice of the SOR relaxation factor. The first steps run with omg of the parameter
+ * file; their convergence factor lambda gives the spectral radius mu of the Jacobi iteration by
+ * Young's relation (lambda + omg - 1)^2 = lambda omg^2 mu^2 and so the asymptotically optimal
+ * factor 2/(1 + sqrt(1 - mu^2)). The short solves of a time step prefer a smaller factor and
+ * the best one changes as the flow develops, so the asymptotic factor is only the upper bound
+ * of a search that runs with the flow: every round compares the iterations of omg - delta,
+ * omg and omg + delta on interleaved time steps and moves omg to the best of them (delta is
+ * doubled if omg moves and halved if it stays). Every OMG_REF-th round compares omg with the factor of the parameter
+ * file to measure the saving.
+ */
+typedef struct {
+  double omg_init;     /* relaxation factor of the parameter file */
+  double omg;          /* current relaxation factor */
+  double delta;        /* step of the search */
+  double omg_max;      /* asymptotically optimal factor */
+  double mu2;          /* largest estimate of mu^2 (0: not known yet) */
+  int steps;           /* steps with omg_init at the start, then steps of the round */
+  int round;           /* number of search rounds */
+  double cand[3];      /* factors of the round */
+  int its[3];          /* iterations of the round per factor */
+  double lres[3];      /* sum of log10 of the final residuals, decides if the iterations are equal */
+  int ref_its[2];      /* iterations with omg and omg_init in the comparison rounds */
+  int ref_steps;       /* steps with omg_init in the comparison rounds */
+  int it_a, it_b;      /* residual checks at the start of the estimation window (a, b >= 2a) */
+  double res_a, res_b;
+  int it_c;            /* last residual check of the solve */
+  double res_c;
+  int iterations;      /* iterations of all solves */
+} omg_tuner;
+
+/**
+ * Starts the tuning with the relaxation factor omg of the parameter file.
+ */
+void omg_tune_init(omg_tuner *ot, double omg);
+
+/**
+ * Records the residual res after iteration it of the current solve (only the iterations in
+ * which the residual is computed).
+ */
+void omg_tune_check(omg_tuner *ot, int it, double res);
+
+/**
+ * Ends the solve of time step n, which took it iterations with the relaxation factor omg, and
+ * returns the relaxation factor of the next step. The chosen factors are printed.
+ */
+double omg_tune_update(omg_tuner *ot, int n, double omg, int it);
+
+/**
+ * Prints the chosen relaxation factor and the estimated saving of iterations.
+ */
+void omg_tune_report(const omg_tuner *ot);
+
+/**
+ * Sets the pressure in the outer boundary cells according to the flags P_L/P_R and the
+ * values lp, rp and dp (homogeneous Neumann conditions otherwise).
+ */
+void set_outer_pressure(
+  int    imax,
+  int    jmax,
+  double **P,
+  double lp,
+  double rp,
+  double dp,
+  uint8_t **Flag
+);
+
+/**
+ * Sets the pressure of the obstacle cells next to the fluid from the boundary cell lists.
+ */
+void set_obstacle_pressure_cells(double **P, const cell_lists *cells);
+
+/**
+ * Sets the pressure of the obstacle cells next to the fluid from their fluid neighbours.
+ */
+void set_obstacle_pressure(
+  int    imax,
+  int    jmax,
+  double **P,
+  uint8_t **Flag
+);
+
+/**
+ * Returns the residual of the pressure equation (L2 norm over the fluid cells).
+ */
+double calculate_res(
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  uint8_t **Flag
+);
+
+/**
+ * Returns the norm of the right hand side in the same norm as calculate_res(), the scale of
+ * the residual for a relative tolerance.
+ */
+double rs_norm(
+  int    imax,
+  int    jmax,
+  double **RS,
+  uint8_t **Flag
+);
+
+/**
+ * Returns the largest absolute residual of the fluid cells. dt times this value is the
+ * divergence that the inexact pressure leaves in the velocities of calculate_uv().
+ */
+double max_res(
+  double dx,
+  double dy,
+  int    imax,
+  int    jmax,
+  double **P,
+  double **RS,
+  uint8_t **Flag
+);
 
 #endif
@@ -1,7 +1,156 @@
 #include "uvp.h"
 #include <math.h>
 #include <stdlib.h>
+#include <limits.h>
 #include "helper.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * F of row i (1 <= i < imax) and G of row i for j=1..jmax-1 according to the formulas of
+ * calculate_fg(), in the fluid cells of the row. The stencils are evaluated in a loop without
+ * branches over each fluid span, so the loops vectorize. F and G in the obstacle cells are
+ * only used on the edges between obstacle and fluid, which set_fg_boundary_cells() sets.
+ */
+static void fg_row(
+		int i,
+		double Re,
+		double GX,
+		double GY,
+		double alpha,
+		double dt,
+		double dx,
+		double dy,
+		int imax,
+		int jmax,
+		int ld,
+		const cell_lists *cells,
+		const double *restrict u,
+		const double *restrict v,
+		double *restrict f,
+		double *restrict g
+)
+{
+	int k, c, c0, c1 ;
+
+	for ( k = cells->span_first[i] ; k < cells->span_first[i+1] ; k++ )
+	{
+		c0 = cells->span[2*k];
+		c1 = cells->span[2*k+1];
+		if ( i < imax )
+		{
+			#pragma omp simd
+			for ( c = c0 ; c < c1 ; c++ )
+			{
+				double d2udx2 = ( u[c+ld]  - 2*u[c] + u[c-ld] ) / ( dx * dx) ;
+
+				double d2udy2 = ( u[c+1]  - 2*u[c] + u[c-1]) / (dy * dy )  ;
+
+				double du2dx = (1/dx) * ( ( (u[c] + u[c+ld])/2 )*( (u[c] + u[c+ld])/2 ) - ( (u[c-ld] + u[c])/2 )*( (u[c-ld] + u[c])/2 ) ) +
+						alpha/dx * ( abs( u[c] + u[c+ld] ) / 2  * ( u[c] - u[c+ld] ) / 2 - abs( u[c-ld] + u[c] ) / 2  * ( u[c-ld] - u[c] ) / 2   ) ;
+
+				double duvdy = (1/dy) * ( ( v[c] + v[c+ld] ) /2  *  ( u[c] + u[c+1] )/2 - (v[c-1] + v[c+ld-1])/2 * (u[c-1] + u[c])/2  ) +
+						alpha/dy * (abs( v[c] + v[c+ld] ) /2  *  ( u[c] - u[c+1] )/2 - abs(v[c-1] + v[c+ld-1])/2 * (u[c-1] - u[c])/2 ) ;
+
+				double fnew = u[c]  + dt * ( 1/Re * ( (d2udx2 ) + (d2udy2) ) - (du2dx)  - duvdy + GX ) ;
+
+				f[c] = fnew;
+			}
+		}
+
+		/* G below the top wall only */
+		if ( c1 > mat_idx(i, jmax, ld) )
+		{
+			c1 = mat_idx(i, jmax, ld);
+		}
+		#pragma omp simd
+		for ( c = c0 ; c < c1 ; c++ )
+		{
+			double d2vdx2 = ( v[c+ld]  - 2*v[c] + v[c-ld] ) / ( dx * dx) ;
+
+			double d2vdy2 = ( v[c+1]  - 2*v[c] + v[c-1]) / (dy * dy )  ;
+
+			double duvdx = (1/dx) * ( ( v[c] + v[c+ld] ) /2  *  ( u[c] + u[c+1] )/2 - (u[c-ld] + u[c-ld+1])/2 * (v[c-ld] + v[c])/2  ) +
+					alpha/dx * (( v[c] - v[c+ld] ) /2  *  abs( u[c] + u[c+1] )/2 - abs(u[c-ld] + u[c-ld+1])/2 * (v[c-ld] - v[c])/2 ) ;
+
+			double dv2dy = (1/dy) * ( ( (v[c] + v[c+1])/2 )*( (v[c] + v[c+1])/2 ) - ( (v[c-1] + v[c])/2 )* (v[c-1] + v[c])/2 )  +
+					alpha/dy * ( abs( v[c] + v[c+1] ) / 2  * ( v[c] - v[c+1] ) / 2 - abs( v[c-1] + v[c] ) / 2  * (  v[c-1] - v[c]  ) / 2   ) ;
+
+			double gnew = v[c]  + dt * ( 1/Re * ( (d2vdx2 ) + (d2vdy2) ) - (duvdx)  - dv2dy + GY ) ;
+
+			g[c] = gnew;
+		}
+	}
+}
+
+/*
+ * Sets F and G on the edges between obstacle and fluid for the boundary cells whose flat
+ * index is below end, starting at the positions kb[] in the lists of the types, and advances
+ * kb[]. The lists are ordered by rows, so a sweep can set the boundary cells row by row.
+ */
+static void set_fg_boundary_cells(
+		int ld,
+		const double *restrict u,
+		const double *restrict v,
+		double *restrict f,
+		double *restrict g,
+		const cell_lists *cells,
+		int *kb,
+		int end
+)
+{
+	int k,c;
+	for(k = kb[CELL_N]; k < cells->nbnd[CELL_N] && (c = cells->bnd[CELL_N][k]) < end; k++){
+		g[c]=v[c];
+	}
+	kb[CELL_N] = k;
+	for(k = kb[CELL_S]; k < cells->nbnd[CELL_S] && (c = cells->bnd[CELL_S][k]) < end; k++){
+		g[c-1]=v[c-1];
+	}
+	kb[CELL_S] = k;
+	for(k = kb[CELL_W]; k < cells->nbnd[CELL_W] && (c = cells->bnd[CELL_W][k]) < end; k++){
+		f[c-ld]=u[c-ld];
+	}
+	kb[CELL_W] = k;
+	for(k = kb[CELL_O]; k < cells->nbnd[CELL_O] && (c = cells->bnd[CELL_O][k]) < end; k++){
+		f[c]=u[c];
+	}
+	kb[CELL_O] = k;
+	for(k = kb[CELL_NO]; k < cells->nbnd[CELL_NO] && (c = cells->bnd[CELL_NO][k]) < end; k++){
+		f[c]=u[c];
+		g[c]=v[c];
+	}
+	kb[CELL_NO] = k;
+	for(k = kb[CELL_NW]; k < cells->nbnd[CELL_NW] && (c = cells->bnd[CELL_NW][k]) < end; k++){
+		f[c-ld]=u[c-ld];
+		g[c]=v[c];
+	}
+	kb[CELL_NW] = k;
+	for(k = kb[CELL_SO]; k < cells->nbnd[CELL_SO] && (c = cells->bnd[CELL_SO][k]) < end; k++){
+		f[c]=u[c];
+		g[c-1]=v[c-1];
+	}
+	kb[CELL_SO] = k;
+	for(k = kb[CELL_SW]; k < cells->nbnd[CELL_SW] && (c = cells->bnd[CELL_SW][k]) < end; k++){
+		f[c-ld]=u[c-ld];
+		g[c-1]=v[c-1];
+	}
+	kb[CELL_SW] = k;
+}
+
+/*
+ * Right hand side of the pressure equation in row i.
+ */
+static void rs_row(int i, double dt, double dx, double dy, int jmax, int ld,
+		const double *restrict f, const double *restrict g, double *restrict rs)
+{
+	int j, c;
+	for(j = 1; j <= jmax; j++) {
+		c = mat_idx(i, j, ld);
+		rs[c] = 1 / dt*( (f[c]-f[c-ld])/dx + (g[c]-g[c-1])/dy);
+	}
+}
 
 /* ----------------------------------------------------------------------- */
 /*                             Function calculate_fg                       */
@@ -42,106 +191,147 @@ void calculate_fg(
 		double **V,
 		double **F,
 		double **G,
-		int **Flag
+		const cell_lists *cells
 )
 
 {
 	int i ;
 	int j ;
-	double du2dx ;
-	double duvdy ;
-	double d2udx2 ;
-	double d2udy2 ;
+	int kb[CELL_TYPES] = {0};
 
-	double dv2dy ;
-	double duvdx ;
-	double d2vdx2 ;
-	double d2vdy2 ;
+	/* the fields share the leading dimension and are indexed in their contiguous storage */
+	const int ld = MATRIX_LD(U);
+	const double *restrict u = U[0];
+	const double *restrict v = V[0];
+	double *restrict f = F[0];
+	double *restrict g = G[0];
 
-	/*Determines the value of F according to the formula above with the help of temporary variables*/
+	/* F and G according to the formulas above, row by row (the rows are independent) */
+	#pragma omp parallel for schedule(static)
 	for ( i = 1 ; i <= imax ; i++ )
 	{
-		for( j = 1 ; j <= jmax ; j++ )
-		{
-			/*
-			 * We need to check that the cell is actually a fluid cell.
-			 */
-			if(((Flag[i][j]&B_C)==B_C)&& i<imax ){
-				d2udx2 = ( U[i+1][j]  - 2*U[i][j] + U[i-1][j] ) / ( dx * dx) ;
-
-				d2udy2 = ( U[i][j+1]  - 2*U[i][j] + U[i][j-1]) / (dy * dy )  ;
-
-				du2dx = (1/dx) * ( ( (U[i][j] + U[i+1][j])/2 )*( (U[i][j] + U[i+1][j])/2 ) - ( (U[i-1][j] + U[i][j])/2 )*( (U[i-1][j] + U[i][j])/2 ) ) +
-						alpha/dx * ( abs( U[i][j] + U[i+1][j] ) / 2  * ( U[i][j] - U[i+1][j] ) / 2 - abs( U[i-1][j] + U[i][j] ) / 2  * ( U[i-1][j] - U[i][j] ) / 2   ) ;
-
-				duvdy = (1/dy) * ( ( V[i][j] + V[i+1][j] ) /2  *  ( U[i][j] + U[i][j+1] )/2 - (V[i][j-1] + V[i+1][j-1])/2 * (U[i][j-1] + U[i][j])/2  ) +
-						alpha/dy * (abs( V[i][j] + V[i+1][j] ) /2  *  ( U[i][j] - U[i][j+1] )/2 - abs(V[i][j-1] + V[i+1][j-1])/2 * (U[i][j-1] - U[i][j])/2 ) ;
+		fg_row(i, Re, GX, GY, alpha, dt, dx, dy, imax, jmax, ld, cells, u, v, f, g);
+	}
 
-				F[i][j] = U[i][j]  + dt * ( 1/Re * ( (d2udx2 ) + (d2udy2) ) - (du2dx)  - duvdy + GX ) ;
+	/*
+	 * For the boundary cells only the values of F and G on the edges to the fluid are needed,
+	 * they are taken from the lists of the boundary cell types.
+	 */
+	set_fg_boundary_cells(ld, u, v, f, g, cells, kb, INT_MAX);
 
-			}
-			/*Determines the value of G according to the formula above with the help of temporary variables*/
-			if(((Flag[i][j]&B_C)==B_C) && j<jmax ){
-				d2vdx2 = ( V[i+1][j]  - 2*V[i][j] + V[i-1][j] ) / ( dx * dx) ;
+	/*Set boundary values along the columns*/
+	for (j = 1; j <= jmax; j++){
+		/*F values on right and left boundaries*/
+		f[mat_idx(0, j, ld)] = u[mat_idx(0, j, ld)];
+		f[mat_idx(imax, j, ld)] = u[mat_idx(imax, j, ld)];
+	}
 
-				d2vdy2 = ( V[i][j+1]  - 2*V[i][j] + V[i][j-1]) / (dy * dy )  ;
+	/*Set boundary values along the rows*/
+	for (i = 1; i <= imax; i++){
+		/*G values on top and bottom boundaries*/
+		g[mat_idx(i, 0, ld)] = v[mat_idx(i, 0, ld)];
+		g[mat_idx(i, jmax, ld)] = v[mat_idx(i, jmax, ld)];
+	}
+}
 
-				duvdx = (1/dx) * ( ( V[i][j] + V[i+1][j] ) /2  *  ( U[i][j] + U[i][j+1] )/2 - (U[i-1][j] + U[i-1][j+1])/2 * (V[i-1][j] + V[i][j])/2  ) +
-						alpha/dx * (( V[i][j] - V[i+1][j] ) /2  *  abs( U[i][j] + U[i][j+1] )/2 - abs(U[i-1][j] + U[i-1][j+1])/2 * (V[i-1][j] - V[i][j])/2 ) ;
+/*
+ * calculate_fg() and calculate_rs() in one sweep: the boundary values of row i are set right
+ * after its F and G, then row i-1 is final and its right hand side is computed while F and G
+ * are still in cache. The result is the same as calling the two functions, for any number of
+ * threads.
+ */
+void calculate_fg_rs(
+		double Re,
+		double GX,
+		double GY,
+		double alpha,
+		double dt,
+		double dx,
+		double dy,
+		int imax,
+		int jmax,
+		double **U,
+		double **V,
+		double **F,
+		double **G,
+		double **RS,
+		const cell_lists *cells
+)
+{
+	const int ld = MATRIX_LD(U);
+	const double *restrict u = U[0];
+	const double *restrict v = V[0];
+	double *restrict f = F[0];
+	double *restrict g = G[0];
+	double *restrict rs = RS[0];
 
-				dv2dy = (1/dy) * ( ( (V[i][j] + V[i][j+1])/2 )*( (V[i][j] + V[i][j+1])/2 ) - ( (V[i][j-1] + V[i][j])/2 )* (V[i][j-1] + V[i][j])/2 )  +
-						alpha/dy * ( abs( V[i][j] + V[i][j+1] ) / 2  * ( V[i][j] - V[i][j+1] ) / 2 - abs( V[i][j-1] + V[i][j] ) / 2  * (  V[i][j-1] - V[i][j]  ) / 2   ) ;
+	/*
+	 * Every thread sweeps a block of rows i0..i1. The boundary cells of row i0 set F of row
+	 * i0-1 of the thread before, so they are set after the barrier. The rows i0 and i1 of
+	 * RS, which need F of the neighbouring blocks, and row i0+1, which needs F of row i0
+	 * from those boundary cells, are computed after a second barrier.
+	 */
+	#pragma omp parallel
+	{
+		int i, j, i0, i1, t = 0, nt = 1;
+		int kb[CELL_TYPES];
+#ifdef _OPENMP
+		t = omp_get_thread_num();
+		nt = omp_get_num_threads();
+#endif
+		i0 = 1 + (int)((long)imax*t/nt);
+		i1 = (int)((long)imax*(t+1)/nt);
 
-				G[i][j] = V[i][j]  + dt * ( 1/Re * ( (d2vdx2 ) + (d2vdy2) ) - (duvdx)  - dv2dy + GY ) ;
-			}
-			/*
-			 * In case its a boundary cell, then we check it by comparing the flags and calculate
-			 * only the useful values of F and G.
-			 */
-			if((Flag[i][j]&31)==B_N){
-				G[i][j]=V[i][j];
-			}
-			else if((Flag[i][j]&31)==B_S){
-				G[i][j-1]=V[i][j-1];
-			}
-			else if((Flag[i][j]&31)==B_W){
-				F[i-1][j]=U[i-1][j];
-			}
-			else if((Flag[i][j]&31)==B_O){
-				F[i][j]=U[i][j];
-			}
-			else if((Flag[i][j]&31)==B_NO){
-				F[i][j]=U[i][j];
-				G[i][j]=V[i][j];
+		cell_lists_seek(cells, mat_idx(i0+1, 0, ld), kb);
+		for ( i = i0 ; i <= i1 ; i++ )
+		{
+			fg_row(i, Re, GX, GY, alpha, dt, dx, dy, imax, jmax, ld, cells, u, v, f, g);
+			g[mat_idx(i, 0, ld)] = v[mat_idx(i, 0, ld)];
+			g[mat_idx(i, jmax, ld)] = v[mat_idx(i, jmax, ld)];
+			/* the boundary cells of row i may still set F of row i-1 */
+			if ( i > i0 )
+			{
+				set_fg_boundary_cells(ld, u, v, f, g, cells, kb, mat_idx(i+1, 0, ld));
 			}
-			else if((Flag[i][j]&31)==B_NW){
-				F[i-1][j]=U[i-1][j];
-				G[i][j]=V[i][j];
+			if ( i > i0 + 2 )
+			{
+				rs_row(i-1, dt, dx, dy, jmax, ld, f, g, rs);
 			}
-			else if((Flag[i][j]&31)==B_SO){
-				F[i][j]=U[i][j];
-				G[i][j-1]=V[i][j-1];
+		}
+		#pragma omp barrier
+
+		if ( i0 <= i1 )
+		{
+			cell_lists_seek(cells, mat_idx(i0, 0, ld), kb);
+			set_fg_boundary_cells(ld, u, v, f, g, cells, kb, mat_idx(i0+1, 0, ld));
+		}
+		/* F on the left and right boundaries, needed by the first and last row of RS */
+		if ( i0 == 1 && i0 <= i1 )
+		{
+			for (j = 1; j <= jmax; j++){
+				f[mat_idx(0, j, ld)] = u[mat_idx(0, j, ld)];
 			}
-			else if((Flag[i][j]&31)==B_SW){
-				F[i-1][j]=U[i-1][j];
-				G[i][j-1]=V[i][j-1];
+		}
+		if ( i1 == imax && i0 <= i1 )
+		{
+			for (j = 1; j <= jmax; j++){
+				f[mat_idx(imax, j, ld)] = u[mat_idx(imax, j, ld)];
 			}
 		}
-	}
-
-
-	/*Set boundary values along the columns*/
-	for (j = 1; j <= jmax; j++){
-		/*F values on right and left boundaries*/
-		F[0][j] = U[0][j];
-		F[imax][j] = U[imax][j];
-	}
+		#pragma omp barrier
 
-	/*Set boundary values along the rows*/
-	for (i = 1; i <= imax; i++){
-		/*G values on top and bottom boundaries*/
-		G[i][0] = V[i][0];
-		G[i][jmax] = V[i][jmax];
+		if ( i0 <= i1 )
+		{
+			rs_row(i0, dt, dx, dy, jmax, ld, f, g, rs);
+		}
+		if ( i1 > i0 + 1 )
+		{
+			rs_row(i0+1, dt, dx, dy, jmax, ld, f, g, rs);
+		}
+		if ( i1 > i0 )
+		{
+			rs_row(i1, dt, dx, dy, jmax, ld, f, g, rs);
+		}
 	}
 }
 
@@ -166,11 +356,10 @@ void calculate_rs(
 		double **G,
 		double **RS
 ) {
-	int i, j;
+	int i;
+	#pragma omp parallel for schedule(static)
 	for(i = 1; i <= imax; i++) {
-		for(j = 1; j <= jmax; j++) {
-			RS[i][j] = 1 / dt*( (F[i][j]-F[i-1][j])/dx + (G[i][j]-G[i][j-1])/dy);
-		}
+		rs_row(i, dt, dx, dy, jmax, MATRIX_LD(RS), F[0], G[0], RS[0]);
 	}
 }
 
@@ -196,25 +385,42 @@ void calculate_dt(
 		int jmax,
 		double **U,
 		double **V,
-		int **Flag
+		const cell_lists *cells
 ) {
 	/*calculates maximum absolute velocities in x and y direction*/
 	double umax=0, vmax=0;
-	double a,b,c;
-	int i, j;
+	int i, s, k;
+	const double *restrict u = U[0];
+	const double *restrict v = V[0];
+	/* the maxima are exact, so the reduction gives the same result for any thread count */
+	#pragma omp parallel for private(s, k) reduction(max: umax, vmax) schedule(static)
 	for(i = 1; i <= imax; i++) {
-		for(j = 1; j<=jmax; j++) {
-			if((Flag[i][j]&B_C)==B_C){
-				if(abs(U[i][j])>umax)
-					umax = abs(U[i][j]);
-
-				if(abs(V[i][j])>vmax)
-					vmax = abs(V[i][j]);
+		/* the fluid cells of column i */
+		for(s = cells->span_first[i]; s < cells->span_first[i+1]; s++) {
+			for(k = cells->span[2*s]; k < cells->span[2*s+1]; k++) {
+				if(abs(u[k])>umax)
+					umax = abs(u[k]);
 
+				if(abs(v[k])>vmax)
+					vmax = abs(v[k]);
 			}
 		}
 	}
 
+	select_dt(Re, tau, dt, dx, dy, umax, vmax);
+}
+
+void select_dt(
+		double Re,
+		double tau,
+		double *dt,
+		double dx,
+		double dy,
+		double umax,
+		double vmax
+) {
+	double a,b,c;
+
 	/*Determines the minimum of dt according to stability criteria and multiply it by safety factor tau if tau is positive, otherwise uses the default value of dt*/
 	if (tau>0){
 		a = Re/(2.0*(1.0/(dx*dx)+1.0/(dy*dy)));
@@ -260,25 +466,95 @@ void calculate_uv(
 		double **F,
 		double **G,
 		double **P,
-		int **Flag
+		const cell_lists *cells
 ){
 	int i;
-	int j;
+	int s;
+	int c, c0, c1;
+	const int ld = MATRIX_LD(U);
+	double *restrict u = U[0];
+	double *restrict v = V[0];
+	const double *restrict f = F[0];
+	const double *restrict g = G[0];
+	const double *restrict p = P[0];
+	#pragma omp parallel for private(s, c, c0, c1) schedule(static)
 	for(i = 1; i <= imax; i++){
-		for(j = 1; j <= jmax; j++){
-			/*
-			 * Check that the cell is a fluid cell.
-			 */
-			if((Flag[i][j]&B_C)==B_C){
-				/*Calculate the new velocity U according to the formula above*/
+		/*
+		 * Only the fluid cells, the spans of column i.
+		 */
+		for(s = cells->span_first[i]; s < cells->span_first[i+1]; s++){
+			c0 = cells->span[2*s];
+			c1 = cells->span[2*s+1];
+			/*Calculate the new velocity U according to the formula above*/
+			if(i<imax){
+				#pragma omp simd
+				for(c = c0; c < c1; c++){
+					u[c] = f[c]-(dt/dx)*(p[c+ld]-p[c]);
+				}
+			}
+			/*Calculate the new velocity V according to the formula above (j<jmax)*/
+			if(c1 > mat_idx(i, jmax, ld)){
+				c1 = mat_idx(i, jmax, ld);
+			}
+			#pragma omp simd
+			for(c = c0; c < c1; c++){
+				v[c] = g[c]-(dt/dy)*(p[c+1]-p[c]);
+			}
+		}
+	}
+}
+
+/*
+ * calculate_uv() which also returns the maximum absolute velocities of the fluid cells for
+ * the next calculate_dt() (see select_dt()). The velocities of the fluid cells in column
+ * imax and row jmax are not changed here, they enter the maxima with their current values.
+ */
+void calculate_uv_max(
+		double dt,
+		double dx,
+		double dy,
+		int imax,
+		int jmax,
+		double **U,
+		double **V,
+		double **F,
+		double **G,
+		double **P,
+		const cell_lists *cells,
+		double *umax,
+		double *vmax
+){
+	int i;
+	int s;
+	int c, c0, c1;
+	double um = 0, vm = 0;
+	const int ld = MATRIX_LD(U);
+	double *restrict u = U[0];
+	double *restrict v = V[0];
+	const double *restrict f = F[0];
+	const double *restrict g = G[0];
+	const double *restrict p = P[0];
+	#pragma omp parallel for private(s, c, c0, c1) reduction(max: um, vm) schedule(static)
+	for(i = 1; i <= imax; i++){
+		for(s = cells->span_first[i]; s < cells->span_first[i+1]; s++){
+			c0 = cells->span[2*s];
+			c1 = cells->span[2*s+1];
+			for(c = c0; c < c1; c++){
 				if(i<imax){
-					U[i][j] = F[i][j]-(dt/dx)*(P[i+1][j]-P[i][j]);
+					u[c] = f[c]-(dt/dx)*(p[c+ld]-p[c]);
 				}
-				/*Calculate the new velocity V according to the formula above*/
-				if(j<jmax){
-					V[i][j] = G[i][j]-(dt/dy)*(P[i][j+1]-P[i][j]);
+				if(c < mat_idx(i, jmax, ld)){
+					v[c] = g[c]-(dt/dy)*(p[c+1]-p[c]);
 				}
+				/* same comparison as calculate_dt() */
+				if(abs(u[c])>um)
+					um = abs(u[c]);
+
+				if(abs(v[c])>vm)
+					vm = abs(v[c]);
 			}
 		}
 	}
+	*umax = um;
+	*vmax = vm;
 }
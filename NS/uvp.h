@@ -1,6 +1,8 @@
 #ifndef __UVP_H__
 #define __UVP_H__
 
+#include "helper.h"
+
 
 /**
  * Determines the value of U and G according to the formula
@@ -22,6 +24,8 @@
  *
  * @f$ i=1,\ldots,imax, \quad j=1,\ldots,jmax-1 @f$
  *
+ * F and G are computed row by row in vectorized loops over the fluid spans of the rows, the
+ * values on the obstacle edges are then set from the boundary cell lists built by init_flag().
  */
 void calculate_fg(
   double Re,
@@ -37,7 +41,30 @@ void calculate_fg(
   double **V,
   double **F,
   double **G,
-  int **Flag
+  const cell_lists *cells
+  );
+
+/**
+ * calculate_fg() and calculate_rs() fused into one sweep over the grid: the right hand side
+ * of a row is computed as soon as F and G of the row and its neighbours are final. The
+ * result is the same as calling the two functions.
+ */
+void calculate_fg_rs(
+  double Re,
+  double GX,
+  double GY,
+  double alpha,
+  double dt,
+  double dx,
+  double dy,
+  int imax,
+  int jmax,
+  double **U,
+  double **V,
+  double **F,
+  double **G,
+  double **RS,
+  const cell_lists *cells
   );
 
 
@@ -78,7 +105,20 @@ void calculate_dt(
   int jmax,
   double **U,
   double **V,
-  int **Flag
+  const cell_lists *cells
+);
+
+/**
+ * The time step of calculate_dt() from given maximum absolute velocities umax and vmax.
+ */
+void select_dt(
+  double Re,
+  double tau,
+  double *dt,
+  double dx,
+  double dy,
+  double umax,
+  double vmax
 );
 
 
@@ -106,7 +146,28 @@ void calculate_uv(
   double **F,
   double **G,
   double **P,
-  int **Flag
+  const cell_lists *cells
+);
+
+/**
+ * calculate_uv() which also reduces the maximum absolute velocities of the fluid cells in
+ * the same sweep, as calculate_dt() would compute them from the new velocities. With
+ * select_dt() this saves the pass over U and V at the start of the next time step.
+ */
+void calculate_uv_max(
+  double dt,
+  double dx,
+  double dy,
+  int imax,
+  int jmax,
+  double **U,
+  double **V,
+  double **F,
+  double **G,
+  double **P,
+  const cell_lists *cells,
+  double *umax,
+  double *vmax
 );
 
 #endif
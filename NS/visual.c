@@ -14,7 +14,7 @@ void write_vtkFile(const char *szProblem,
                    double **U,
                    double **V,
                    double **P,
-                   int **Flag
+                   uint8_t **Flag
                    ) {
     
     int i,j;
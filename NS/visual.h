@@ -32,7 +32,7 @@ void write_vtkFile(const char *szProblem,
                   double **U,
                   double **V,
                   double **P,
-                  int **Flag);
+                  uint8_t **Flag);
 
 /**
  * Method for writing header information in vtk format. 